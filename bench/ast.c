@@ -0,0 +1,146 @@
+/********************************************************************************
+ * File Name: bench/ast.c                                                       *
+ *                                                                              *
+ * Description: AST micro-benchmark, parses a generated program of about one    *
+ *              million nodes and reports the AST memory, the peak RSS of the   *
+ *              process and the time spent generating code from the tree.       *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ *                                                                              *
+ * Execution:                                                                   *
+ *    make bench                                                                *
+ *    ./bin/bench_ast [functions]                                               *
+ ********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+#define DEFAULT_FUNCTIONS 800 // Generated functions, about 1250 nodes each
+#define STATEMENTS 50         // Statements per function
+#define ROUNDS 5              // Timed code generation rounds, the best one is reported
+
+// Statement repeated in every function body
+static const char *const Statement =
+    "    v += (a + b) * (c - d) + (a * c - b) %% (d + 1) - (b - a) * %d;\n";
+
+/**
+ * Returns a monotonic timestamp in seconds.
+ *
+ * @return The current time
+ */
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Counts the nodes of a tree.
+ *
+ * @param n Root of the tree
+ * @return Number of nodes
+ */
+static long count_nodes(ASTnode *n)
+{
+    long count = 1;
+
+    if (n == NULL)
+    {
+        return 0;
+    }
+    if (n->type == A_SEQ)
+    {
+        for (int i = 0; i < AST_VALUE(n).list->count; i++)
+        {
+            count += count_nodes(AST_NODE(AST_VALUE(n).list->item[i]));
+        }
+        return count;
+    }
+    return count + count_nodes(AST_LEFT(n)) + count_nodes(AST_MID(n)) + count_nodes(AST_RIGHT(n));
+}
+
+/**
+ * Entry point of the benchmark.
+ *
+ * @param argc Argument count
+ * @param argv Argument values
+ * @return 0 on success
+ */
+int main(int argc, char *argv[])
+{
+    int functions = argc > 1 ? atoi(argv[1]) : DEFAULT_FUNCTIONS;
+    size_t cap = (size_t)functions * (STATEMENTS + 4) * 96 + 1, len = 0;
+    char *buf = (char *)malloc(cap);
+    double t0, parse, best = 0;
+    struct rusage ru;
+    ASTnode *tree;
+
+    if (buf == NULL || functions <= 0)
+    {
+        fprintf(stderr, "Usage: %s [functions]\n", argv[0]);
+        return 1;
+    }
+
+    // Generate the source
+    for (int f = 0; f < functions; f++)
+    {
+        len += snprintf(buf + len, cap - len, "fun f%d(a: int, b: int): int {\n"
+                                              "    var c: int = a; var d: int = b; var v: int = 0;\n", f);
+        for (int s = 0; s < STATEMENTS; s++)
+        {
+            len += snprintf(buf + len, cap - len, Statement, s);
+        }
+        len += snprintf(buf + len, cap - len, "    return v;\n}\n");
+    }
+
+    // Front end
+    t0 = now();
+    InputStart = InputPtr = buf;
+    InputEnd = buf + len;
+    tokenize();
+    advance();
+    tree = compound_statement();
+    free_tokens();
+    parse = now() - t0;
+
+    // Back end, the output is thrown away
+    if ((OutFile = fopen("/dev/null", "w")) == NULL)
+    {
+        perror("/dev/null");
+        return 1;
+    }
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        double dt;
+
+        t0 = now();
+        gencode(tree);
+        dt = now() - t0;
+        if (best == 0 || dt < best)
+        {
+            best = dt;
+        }
+    }
+    fclose(OutFile);
+
+    getrusage(RUSAGE_SELF, &ru);
+    printf("AST (%d functions, %zu bytes of source)\n", functions, len);
+    printf("  nodes        %12ld\n", count_nodes(tree));
+    printf("  ast bytes    %12zu\n", AstArena.peak);
+    printf("  peak rss     %12ld KiB\n", ru.ru_maxrss);
+    printf("  parse        %12.3f ms\n", parse * 1e3);
+    printf("  codegen      %12.3f ms\n", best * 1e3);
+
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,277 @@
+/********************************************************************************
+ * File Name: bench/lex.c                                                       *
+ *                                                                              *
+ * Description: Lexer micro-benchmark, measures keyword recognition with the    *
+ *              old switch + strcmp lookup against the perfect hash, and the    *
+ *              throughput of a full tokenize() pass.                           *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ *                                                                              *
+ * Execution:                                                                   *
+ *    make bench                                                                *
+ *    ./bin/bench_lex [lines]                                                   *
+ ********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+#define DEFAULT_LINES 200000 // Lines of generated source
+#define ROUNDS 5             // Timed rounds, the best one is reported
+
+// Generated source lines, a mix of keywords, identifiers and comments
+static const char *const Sample[] = {
+    "var counter%d: int = limit + %d; # running total\n",
+    "    loop (var i: int = 0; i < counter%d; i += 1) {\n",
+    "        if (flag && value%d >= %d) { print(value); } else { next; }\n",
+    "    match (state%d) { 1: stop; _: print(%d); }\n",
+    "fun helper%d(x: int, y: bool): int { return x * %d; }\n",
+    "# ---------------------------------------------------------------- %d %d\n",
+};
+
+static volatile unsigned Sink; // Keeps the identifier hashes alive
+
+/**
+ * Returns a monotonic timestamp in seconds.
+ *
+ * @return The current time
+ */
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Reference keyword lookup, the switch + strcmp version the lexer used to have.
+ *
+ * @param s NUL terminated identifier
+ * @return The TokenType (keyword or T_IDENT)
+ */
+static int keyword_strcmp(char *s)
+{
+    switch (*s)
+    {
+    case '_':
+        return s[1] == '\0' ? T_UNDERSCORE : T_IDENT;
+    case 'b':
+        return !strcmp(s, "bool") ? T_BOOL : T_IDENT;
+    case 'c':
+        return !strcmp(s, "const") ? T_CONST : T_IDENT;
+    case 'e':
+        return !strcmp(s, "else") ? T_ELSE : T_IDENT;
+    case 'f':
+        if (!strcmp(s, "false"))
+        {
+            return T_FALSE;
+        }
+        return !strcmp(s, "fun") ? T_FUN : T_IDENT;
+    case 'i':
+        if (!strcmp(s, "if"))
+        {
+            return T_IF;
+        }
+        return !strcmp(s, "int") ? T_INT : T_IDENT;
+    case 'l':
+        return !strcmp(s, "loop") ? T_LOOP : T_IDENT;
+    case 'm':
+        return !strcmp(s, "match") ? T_MATCH : T_IDENT;
+    case 'n':
+        return !strcmp(s, "next") ? T_NEXT : T_IDENT;
+    case 'p':
+        return !strcmp(s, "print") ? T_PRINT : T_IDENT;
+    case 'r':
+        return !strcmp(s, "return") ? T_RETURN : T_IDENT;
+    case 's':
+        return !strcmp(s, "stop") ? T_STOP : T_IDENT;
+    case 't':
+        return !strcmp(s, "true") ? T_TRUE : T_IDENT;
+    case 'v':
+        if (!strcmp(s, "var"))
+        {
+            return T_VAR;
+        }
+        return !strcmp(s, "void") ? T_VOID : T_IDENT;
+    }
+    return T_IDENT;
+}
+
+/**
+ * Walks every word of the buffer and classifies it the old way: copy, then switch + strcmp,
+ * identifiers are then hashed separately for interning.
+ *
+ * @param p Start of the buffer
+ * @param end End of the buffer
+ * @param keywords Where to count the keywords found
+ * @return Number of words classified
+ */
+static long classify_strcmp(char *p, char *end, long *keywords)
+{
+    long words = 0;
+
+    while (p < end)
+    {
+        if (isalpha((unsigned char)*p) || *p == '_')
+        {
+            char buf[MAX_LEN];
+            int i = 0;
+
+            while (p < end && (isalnum((unsigned char)*p) || *p == '_'))
+            {
+                buf[i++] = *p++;
+            }
+            buf[i] = '\0';
+            if (keyword_strcmp(buf) != T_IDENT)
+            {
+                (*keywords)++;
+            }
+            else
+            {
+                Sink += strhash(buf, i);
+            }
+            words++;
+        }
+        else
+        {
+            p++;
+        }
+    }
+    return words;
+}
+
+/**
+ * Walks every word of the buffer and classifies it with the perfect hash computed while scanning,
+ * the same hash is then reused for interning.
+ *
+ * @param p Start of the buffer
+ * @param end End of the buffer
+ * @param keywords Where to count the keywords found
+ * @return Number of words classified
+ */
+static long classify_hash(char *p, char *end, long *keywords)
+{
+    long words = 0;
+
+    while (p < end)
+    {
+        if (isalpha((unsigned char)*p) || *p == '_')
+        {
+            char *start = p;
+            unsigned h = HASH_INIT;
+
+            while (p < end && (isalnum((unsigned char)*p) || *p == '_'))
+            {
+                h = HASH_STEP(h, *p);
+                p++;
+            }
+            if (keyword(start, p - start, h) != T_IDENT)
+            {
+                (*keywords)++;
+            }
+            else
+            {
+                Sink += h;
+            }
+            words++;
+        }
+        else
+        {
+            p++;
+        }
+    }
+    return words;
+}
+
+/**
+ * Times a classifier over the buffer and prints its throughput.
+ *
+ * @param name Label of the run
+ * @param fn The classifier
+ * @param buf Start of the buffer
+ * @param end End of the buffer
+ * @return Best words per second
+ */
+static double run_classifier(char *name, long (*fn)(char *, char *, long *), char *buf, char *end)
+{
+    double best = 0;
+    long words = 0, keywords = 0;
+
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        double t0 = now(), dt;
+
+        keywords = 0;
+        words = fn(buf, end, &keywords);
+        dt = now() - t0;
+        if (best == 0 || words / dt > best)
+        {
+            best = words / dt;
+        }
+    }
+    printf("  %-22s %10ld words %9ld keywords %12.0f words/s\n", name, words, keywords, best);
+    return best;
+}
+
+/**
+ * Entry point of the benchmark.
+ *
+ * @param argc Argument count
+ * @param argv Argument values
+ * @return 0 on success
+ */
+int main(int argc, char *argv[])
+{
+    int lines = argc > 1 ? atoi(argv[1]) : DEFAULT_LINES;
+    size_t cap = (size_t)lines * 96 + 1, len = 0;
+    char *buf = (char *)malloc(cap);
+    double before, after, best = 0;
+
+    if (buf == NULL || lines <= 0)
+    {
+        fprintf(stderr, "Usage: %s [lines]\n", argv[0]);
+        return 1;
+    }
+
+    // Generate the source
+    for (int i = 0; i < lines; i++)
+    {
+        len += snprintf(buf + len, cap - len, Sample[i % (sizeof(Sample) / sizeof(Sample[0]))], i % 997, i);
+    }
+    init_keywords();
+
+    printf("Keyword recognition (%d lines, %zu bytes)\n", lines, len);
+    before = run_classifier("before: switch+strcmp", classify_strcmp, buf, buf + len);
+    after = run_classifier("after: perfect hash", classify_hash, buf, buf + len);
+    printf("  speedup %.2fx\n", after / before);
+
+    // Full lexer pass
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        double t0 = now(), dt;
+        int count;
+
+        InputStart = InputPtr = buf;
+        InputEnd = buf + len;
+        tokenize();
+        dt = now() - t0;
+        count = Tokens.count;
+        free_tokens();
+        if (best == 0 || count / dt > best)
+        {
+            best = count / dt;
+        }
+    }
+    printf("Full tokenize()\n  %12.0f tokens/s\n", best);
+
+    free(buf);
+    return 0;
+}
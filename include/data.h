@@ -20,25 +20,45 @@
 #endif
 
 // Scanner state
-extern_ int Putback;        // Character put back into stream
-extern_ int Line;           // Current line number
-extern_ int Column;         // Current column number
-extern_ int Length;         // Length of current token
+extern_ int Line;           // Line of the current token
+extern_ int Column;         // Column of the current token
 extern_ Token CurrentToken; // The token currently being analyzed
+extern_ TokenStream Tokens; // Pre-scanned token stream
+extern_ int TokenPos;       // Index of CurrentToken in the stream
 
 // Parser state
 extern_ Symbol *CurrentFunction; // The function that is currently being analyzed
 extern_ Control *CurrentControl; // The control that is currently being analyzed
 
+// Abstract Syntax Tree
+extern_ ASTchunk **ASTchunks; // Node storage, indexed by the high bits of a NodeId
+
 // Scope manager
 extern_ Scope *CurrentScope; // Points to the currently active scope
 extern_ int LocalOffset;     // Stack position
 
+// Memory
+extern_ Arena TokenArena; // Token stream, released after parsing
+extern_ Arena AstArena;   // AST nodes
+extern_ Arena SymArena;   // Symbols, scopes and interned names
+extern_ Arena GenArena;   // Code generation scratch
+extern_ Arena IrArena;    // Intermediate representation
+extern_ int MemReport;    // Print the arena usage at exit
+
 // Code generation
-extern_ struct Backend *CG; // Pointer to the backend implementation
+extern_ struct Backend *CG;   // Pointer to the backend implementation
+extern_ int OptLevel;         // Optimization level, 0 skips the IR
+extern_ int EmitIR;           // Write the IR instead of assembly
+extern_ int OptReport;        // Print what the optimizer changed
+extern_ int InlineThreshold;  // Largest function inlined at every call site
+extern_ OptStats Stats;       // What the optimizer changed
+
+// Input buffer
+extern_ char *InputStart; // Start of the input buffer
+extern_ char *InputPtr;   // Current scanning position
+extern_ char *InputEnd;   // End of the input buffer (sentinel)
 
 // File handles
-extern_ FILE *InputFile;      // Pointer to the input file
 extern_ char *InputFilename;  // Name of the input file
 extern_ FILE *OutFile;        // Pointer to the output file
 extern_ char *OutputFilename; // Name of the output file
@@ -12,10 +12,31 @@
 
 #include "defs.h"
 
+// Memory
+void *arena_alloc(Arena *a, size_t size);
+void *arena_grow(Arena *a, void *p, size_t old, size_t size);
+void arena_free(Arena *a);
+void mem_report(void);
+
+// Input
+void open_input(char *filename);
+void close_input(void);
+
+// Name interning
+unsigned strhash(char *s, int len);
+int intern(char *s, int len, unsigned h);
+char *name_of(int id);
+
 // Lexer
-int scan(Token *t);
+char *skip_blanks(char *p, char *end, int *lines, char **lastnl);
+char *find_newline(char *p, char *end);
+void init_keywords(void);
+int keyword(char *s, int len, unsigned h);
+void tokenize(void);
+void free_tokens(void);
+void advance(void);
 void match(TokenType t);
-TokenType peek(void);
+TokenType peek(int k);
 
 // Parser
 ASTnode *var_declaration(void);
@@ -28,6 +49,14 @@ ASTnode *mkastleaf(ASTnodeType type, PType ptype, Value value);
 ASTnode *mkastunary(ASTnodeType type, ASTnode *child, Value value);
 ASTnode *mkastbinary(ASTnodeType type, ASTnode *left, ASTnode *right, Value value);
 ASTnode *mkastternary(ASTnodeType type, ASTnode *left, ASTnode *mid, ASTnode *right, Value value);
+int seq_begin(void);
+void seq_add(ASTnode *stmt);
+ASTnode *seq_end(int mark);
+long long eval_binary(ASTnodeType type, long long a, long long b, int *ok);
+int is_const(ASTnode *n);
+long long const_value(ASTnode *n);
+int literal_cases(ASTnode *n);
+void free_ast(void);
 
 // Symbol Table
 void scope_enter(void);
@@ -36,6 +65,51 @@ int is_global_scope(void);
 Symbol *find_in_current_scope(char *name);
 Symbol *findsymbol(char *name);
 Symbol *addsymbol(char *name, SType stype, PType ptype);
+int is_nested_in(Symbol *fn, Symbol *outer);
+
+// Intermediate representation
+IRfunc *ir_func(Symbol *sym);
+IRblock *ir_block(IRfunc *f);
+IRinstr *ir_instr(IRfunc *f, IRop op, int nargs);
+void ir_add_arg(IRinstr *in, int v);
+void ir_append(IRblock *b, IRinstr *in);
+void ir_insert_before(IRinstr *pos, IRinstr *in);
+void ir_remove(IRfunc *f, IRinstr *in);
+void ir_edge(IRblock *from, IRblock *to);
+void ir_add_pred(IRblock *b, IRblock *pred);
+void ir_add_succ(IRblock *b, IRblock *succ);
+void ir_remove_edge(IRblock *from, int k);
+void ir_retarget(IRblock *from, int k, IRblock *to);
+int ir_resolve(IRfunc *f, int v);
+void ir_replace(IRfunc *f, int v, int with);
+void ir_rewrite(IRfunc *f);
+int ir_is_terminator(IRop op);
+int ir_has_effects(IRop op);
+int ir_is_narrow(IRfunc *f, int v);
+int ir_const(IRfunc *f, int val);
+int ir_undef(IRfunc *f);
+void ir_cleanup(IRfunc *f);
+IRblock *ir_split_edge(IRfunc *f, IRblock *b, int k);
+IRblock *ir_split_block(IRfunc *f, IRinstr *in);
+IRfunc *ir_callee(IRprogram *p, Symbol *sym);
+int ir_is_tail_call(IRinstr *call);
+void ir_split_edges(IRfunc *f, int (*keep)(IRblock *, int));
+void ir_dominators(IRfunc *f);
+int ir_dominates(IRblock *a, IRblock *b);
+void ir_dump(IRfunc *f, FILE *out);
+IRprogram *ir_build(ASTnode *tree);
+void ir_verify(IRfunc *f);
+void ir_global_constants(IRprogram *p);
+void ir_sccp(IRfunc *f);
+void ir_dce(IRfunc *f);
+void ir_gvn(IRfunc *f);
+void ir_find_pure(IRprogram *p);
+void ir_licm(IRfunc *f);
+void ir_inline(IRprogram *p);
+void ir_tail_recursion(IRfunc *f);
+void ir_optimize(IRprogram *p);
+void opt_report(void);
+void ir_lower(IRfunc *f);
 
 // Code generation
 void gencode(ASTnode *n);
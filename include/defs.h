@@ -11,12 +11,18 @@
 #ifndef DEFS_H
 #define DEFS_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 // Define macros
 #define NO_VALUE \
     (Value) { .symbol = NULL } // Empty value initializer
 #define NO_REG -1              // No register indicator
 #define NO_LABEL -1            // No label indicator
 #define MAX_LEN 512            // Max text characters
+#define HASH_INIT 2166136261u  // FNV-1a offset basis
+#define HASH_STEP(h, c) \
+    (((h) ^ (unsigned char)(c)) * 16777619u) // FNV-1a step
 
 // Token types
 typedef enum TokenType
@@ -71,6 +77,8 @@ typedef enum TokenType
     T_CONST,
     T_VAR,
     T_FUN,
+    T_INLINE,
+    T_NOINLINE,
     T_RETURN,
     T_IF,
     T_ELSE,
@@ -91,6 +99,11 @@ typedef enum TokenType
 
 } TokenType;
 
+// Keywords, all of them spelled out in TokenTypeStr
+#define FIRST_KEYWORD T_TRUE
+#define LAST_KEYWORD T_PRINT
+#define NUM_KEYWORDS (LAST_KEYWORD - FIRST_KEYWORD + 1)
+
 // Token types strings
 static const char *const TokenTypeStr[] = {
     "eof",
@@ -136,6 +149,8 @@ static const char *const TokenTypeStr[] = {
     "const",
     "var",
     "fun",
+    "inline",
+    "noinline",
     "return",
     "if",
     "else",
@@ -215,7 +230,8 @@ typedef enum ASTnodeType
     A_STOP,
     A_NEXT,
     A_PRINT,
-    A_GLUE
+    A_GLUE,
+    A_SEQ
 } ASTnodeType;
 
 // Structural types
@@ -231,24 +247,38 @@ typedef enum SClass
 {
     C_GLOBAL,
     C_LOCAL,
-    C_PARAM
+    C_PARAM,
+    C_IMMEDIATE // Constant known at compile time, it has no storage
 } SClass;
 
+// Inlining hint of a function
+typedef enum Inline
+{
+    INL_AUTO,   // Left to the cost model
+    INL_ALWAYS, // Declared with 'inline'
+    INL_NEVER   // Declared with 'noinline'
+} Inline;
+
 // Symbol Table entry
 typedef struct Symbol
 {
-    char *name;    // Name of the symbol
+    char *name;    // Name of the symbol (interned, unique per name)
     SType stype;   // Structural type
     PType ptype;   // Primitive type
     SClass sclass; // Storage class
 
     int size;   // Size in bytes
     int offset; // Stack offset or label
+    int value;  // Value of a C_IMMEDIATE constant
 
     int numParams;         // Number of function parameters
     struct Symbol *params; // Function parameters
+    Inline inlining;       // Inlining hint of a function
 
-    struct Symbol *next; // Pointer to the next symbol in the list
+    int level;               // Level of the scope that declares it
+    struct Symbol *function; // Function owning a local or parameter, NULL at top level
+    struct Symbol *shadowed; // Binding of the same name it hides, if any
+    struct Symbol *next;     // Pointer to the next symbol in the list
 } Symbol;
 
 // Generic value union
@@ -257,6 +287,7 @@ typedef union Value
     int integer;
     char *string;
     Symbol *symbol;
+    struct NodeList *list;
 } Value;
 
 // Token structure
@@ -266,17 +297,193 @@ typedef struct Token
     Value value;
 } Token;
 
-// Abstract Syntax Tree node
+// Token stream, one entry per token in each array
+typedef struct TokenStream
+{
+    int count;           // Number of tokens (the last one is T_EOF)
+    int capacity;        // Allocated entries
+    unsigned char *type; // Token types
+    int *offset;         // Byte offset of the token in the input buffer
+    int *line;           // Line where the token starts
+    int *column;         // Column where the token starts
+    int *value;          // Interned name id or integer literal value
+} TokenStream;
+
+// Index of an AST node, 0 stands for no node
+typedef uint32_t NodeId;
+
+#define AST_CHUNK_BITS 12                // log2 of the nodes per chunk
+#define AST_CHUNK (1 << AST_CHUNK_BITS) // Nodes per chunk
+#define MAX_AST_CHUNKS 65536            // Chunks a node can name
+
+// Abstract Syntax Tree node, the hot part walked by the code generator (16 bytes)
 typedef struct ASTnode
 {
-    ASTnodeType type;      // Type of the node (A_ADD, A_IF, etc.)
-    PType ptype;           // Primitive type this node results in
-    struct ASTnode *left;  // Left child
-    struct ASTnode *mid;   // Middle child (e.g., 'then' block)
-    struct ASTnode *right; // Right child (e.g., 'else' block)
-    Value value;           // Value of the node
+    unsigned char type;  // Type of the node (A_ADD, A_IF, etc.)
+    unsigned char ptype; // Primitive type this node results in
+    uint16_t chunk;      // Chunk that holds the node
+    NodeId left;         // Left child
+    NodeId mid;          // Middle child (e.g., 'then' block)
+    NodeId right;        // Right child (e.g., 'else' block)
 } ASTnode;
 
+// Block of AST nodes, the values are kept apart as they are rarely read
+typedef struct ASTchunk
+{
+    ASTnode node[AST_CHUNK]; // Hot records
+    Value value[AST_CHUNK];  // Value of every node
+} ASTchunk;
+
+// Statements of an A_SEQ node
+typedef struct NodeList
+{
+    int count;     // Number of statements
+    NodeId item[]; // The statements, in order
+} NodeList;
+
+// AST accessors, the argument is evaluated more than once
+#define AST_NODE(id) ((id) ? &ASTchunks[(id) >> AST_CHUNK_BITS]->node[(id) & (AST_CHUNK - 1)] : NULL)
+#define AST_ID(n) \
+    ((n) ? ((NodeId)(n)->chunk << AST_CHUNK_BITS) | (NodeId)((n) - ASTchunks[(n)->chunk]->node) : 0)
+#define AST_LEFT(n) AST_NODE((n)->left)
+#define AST_MID(n) AST_NODE((n)->mid)
+#define AST_RIGHT(n) AST_NODE((n)->right)
+#define AST_VALUE(n) (ASTchunks[(n)->chunk]->value[(n) - ASTchunks[(n)->chunk]->node])
+
+// Arena block, the allocations follow the header
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *prev; // Previously filled block
+    char *ptr;               // First free byte
+    char *end;               // End of the block
+} ArenaBlock;
+
+// Bump-pointer arena owned by a compiler phase
+typedef struct Arena
+{
+    char *name;        // Name shown in the memory report
+    ArenaBlock *block; // Block being filled
+    void *last;        // Last allocation, the only one that can grow in place
+    size_t objects;    // Objects allocated
+    size_t used;       // Bytes handed out
+    size_t reserved;   // Bytes currently held in blocks
+    size_t peak;       // Highest value of reserved
+} Arena;
+
+// Intermediate representation operations
+typedef enum IRop
+{
+    // Values
+    IR_CONST, // imm
+    IR_PARAM, // imm = parameter index
+    IR_PHI,   // One argument per predecessor, sym = variable it merges
+
+    // Arithmetic
+    IR_NEG,
+    IR_ADD,
+    IR_SUB,
+    IR_MUL,
+    IR_DIV,
+    IR_MOD,
+    IR_POW,
+    IR_SEXT, // Sign extends the low 32 bits, an int stored into a variable
+
+    // Logical
+    IR_NOT,
+
+    // Comparison
+    IR_EQ,
+    IR_NE,
+    IR_LT,
+    IR_LE,
+    IR_GT,
+    IR_GE,
+
+    // Memory, sym = global variable
+    IR_LOAD,
+    IR_STORE,
+
+    // Calls and IO
+    IR_CALL, // sym = function, arguments in order
+    IR_PRINT,
+
+    // Terminators, the targets are the successors of the block
+    IR_JMP,
+    IR_BR,     // Goes to succ[0] when the argument is not zero, else to succ[1]
+    IR_SWITCH, // Goes to succ[k] when args[0] equals the constant args[k + 1], else to the last one
+    IR_RET     // Optional argument
+} IRop;
+
+// Intermediate representation instruction, its id also names the value it defines
+typedef struct IRinstr
+{
+    IRop op;                     // Operation
+    int id;                      // Value number (virtual register)
+    int imm;                     // Constant or parameter index
+    Symbol *sym;                 // Global, callee or variable
+    int nargs;                   // Number of arguments
+    int *args;                   // Value numbers of the arguments
+    struct IRblock *block;       // Block holding the instruction
+    struct IRinstr *prev, *next; // Neighbours in the block
+} IRinstr;
+
+// Basic block, phis come first and a terminator comes last
+typedef struct IRblock
+{
+    int id;                  // Index in the function
+    IRinstr *first, *last;   // Instructions
+    struct IRblock **preds;  // Predecessors, phi arguments follow this order
+    int npreds, maxpreds;    // Number and capacity of preds
+    struct IRblock **succ;   // Successors, see IR_JMP, IR_BR and IR_SWITCH
+    int nsucc, maxsucc;      // Number and capacity of succ
+    int sealed;              // All predecessors are known
+    struct IRblock *idom;    // Immediate dominator
+    int rpo;                 // Position in reverse postorder, -1 if unreachable
+    int label;               // Assembly label
+} IRblock;
+
+// Function in SSA form, the top-level code is a function without symbol
+typedef struct IRfunc
+{
+    Symbol *sym;             // Function symbol, NULL for the top level
+    IRblock **blocks;        // Blocks, blocks[0] is the entry
+    int nblocks, maxblocks;  // Number and capacity of blocks
+    IRinstr **values;        // Defining instruction of every value, NULL once removed
+    int nvalues, maxvalues;  // Number and capacity of values
+    int *forward;            // Replacement of every value, itself if none
+    IRblock **order;         // Reachable blocks in reverse postorder
+    int norder;              // Number of reachable blocks
+    int pure;                // No effects and always returns, so calls to it can move
+    int calls;               // Call sites in the whole program
+    int loads;               // Reads globals, calls to it depend on memory
+} IRfunc;
+
+// Whole program handed to the IR pipeline
+typedef struct IRprogram
+{
+    IRfunc **funcs;          // Functions in SSA form, funcs[0] is the top level
+    int nfuncs, maxfuncs;    // Number and capacity of funcs
+    ASTnode **direct;        // Functions left to the direct code generator
+    int ndirect, maxdirect;  // Number and capacity of direct
+} IRprogram;
+
+// Changes made by the optimizer, printed by --opt-report
+typedef struct OptStats
+{
+    int globals;   // Loads of globals that always hold the same constant
+    int constants; // Values found constant by SCCP
+    int branches;  // Branches folded by SCCP
+    int instrs;    // Instructions removed by SCCP and DCE
+    int blocks;    // Blocks removed by SCCP and DCE
+    int redundant; // Values computed again, removed by GVN
+    int loads;     // Loads of globals replaced by GVN
+    int hoisted;   // Loop-invariant values moved out of their loop
+    int inlined;   // Calls replaced by the body of the callee
+    int loops;     // Recursive calls in tail position turned into jumps back to the start
+    int tailcalls; // Calls in tail position that branch to the callee and leave the frame
+    int dropped;   // Functions never called from the top level, left out of the output
+} OptStats;
+
 // Control Stack entry
 typedef struct Control
 {
@@ -295,6 +502,17 @@ typedef struct Scope
     int pending_offset;   // Tracks stack offset allocation for this specific scope
 } Scope;
 
+// Condition of a comparison, in opposite pairs so c ^ 1 is the opposite of c
+typedef enum Cond
+{
+    C_EQ,
+    C_NE,
+    C_LT,
+    C_GE,
+    C_GT,
+    C_LE
+} Cond;
+
 // Backend interface
 typedef struct Backend
 {
@@ -313,6 +531,7 @@ typedef struct Backend
     void (*preamble)(int);
     void (*postamble)(int);
     void (*call)(char *);
+    void (*tail_call)(char *, int);
     void (*ret)(int);
     // Loading & Storing
     int (*load_int)(int);
@@ -328,6 +547,8 @@ typedef struct Backend
     void (*genlabel)(int);
     void (*jump)(int);
     void (*jump_cond)(int, int);
+    void (*jump_true)(int, int);
+    int (*move)(int, int);
     // Arithmetic operations
     int (*neg)(int);
     int (*add)(int, int);
@@ -335,13 +556,20 @@ typedef struct Backend
     int (*mul)(int, int);
     int (*div)(int, int);
     int (*mod)(int, int);
+    int (*mul_const)(int, int);
+    int (*div_const)(int, int);
+    int (*mod_const)(int, int);
     int (*pow)(int, int);
+    int (*pow_const)(int, int);
+    int (*sext)(int);
     // Logic operations
     int (*not)(int);
-    int (*and)(int, int);
-    int (*or)(int, int);
     // Comparison operations
-    int (*cmp)(int, int, char *);
+    int (*cmp)(int, int, Cond);
+    void (*cmp_jump)(int, int, Cond, int);
+    void (*cmp_jump_const)(int, int, Cond, int);
+    void (*bit_jump)(int, int, Cond, int);
+    void (*switch_jump)(int, int *, int *, int, int);
     // Print
     void (*print)(int);
 } Backend;
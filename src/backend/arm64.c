@@ -170,13 +170,51 @@ static void postamble(int stackSize)
 }
 
 /**
- * Generates a Branch with Link (bl) instruction to call a function.
+ * Generates a Branch with Link (bl) instruction to call a function. The callee is free to use
+ * the temporaries, so the ones holding a value are saved on the stack around the call.
  *
  * @param name The name of the function to be called.
  */
 static void call(char *name)
 {
+    for (int i = 0; i < 7; i++)
+    {
+        if (!freeregs[i])
+        {
+            fprintf(OutFile, "\tstr %s, [sp, #-16]!\n", reglist[i]);
+        }
+    }
     fprintf(OutFile, "\tbl _%s\n", name);
+    for (int i = 6; i >= 0; i--)
+    {
+        if (!freeregs[i])
+        {
+            fprintf(OutFile, "\tldr %s, [sp], #16\n", reglist[i]);
+        }
+    }
+}
+
+/**
+ * Calls a function in tail position, restores the stack and FP/LR like the epilogue and branches
+ * without link, so the callee returns straight to our caller.
+ *
+ * @param name The name of the function to be called
+ * @param stackSize The stack size of the calling function
+ */
+static void tail_call(char *name, int stackSize)
+{
+    // Ensure alignment matches preamble
+    if (stackSize % 16 != 0)
+    {
+        stackSize += (16 - (stackSize % 16));
+    }
+
+    if (stackSize > 0)
+    {
+        fprintf(OutFile, "\tadd sp, sp, #%d\n", stackSize); // Free Locals
+    }
+    fprintf(OutFile, "\tldp x29, x30, [sp], 16\n"); // Restore FP, LR
+    fprintf(OutFile, "\tb _%s\n", name);
 }
 
 /**
@@ -203,7 +241,20 @@ static int load_int(int val)
 {
     int r = alloc_register();
 
-    fprintf(OutFile, "\tmov %s, #%d\n", reglist[r], val);
+    // mov only encodes 16-bit immediates, wider values are built one half at a time
+    if (val >= -65536 && val <= 65535)
+    {
+        fprintf(OutFile, "\tmov %s, #%d\n", reglist[r], val);
+    }
+    else
+    {
+        fprintf(OutFile, "\tmovz %s, #%d\n", wreglist[r], val & 0xffff);
+        fprintf(OutFile, "\tmovk %s, #%d, lsl #16\n", wreglist[r], (val >> 16) & 0xffff);
+        if (val < 0)
+        {
+            fprintf(OutFile, "\tsxtw %s, %s\n", reglist[r], wreglist[r]);
+        }
+    }
     return r;
 }
 
@@ -263,6 +314,34 @@ static int store_glob(int r, Symbol *sym)
     return r;
 }
 
+/**
+ * Formats the address of a stack slot. Offsets out of the reach of ldur/stur are computed
+ * into x16 first.
+ *
+ * @param offset Offset from the frame pointer
+ * @return The address operand, valid until the next call
+ */
+static char *frame_addr(int offset)
+{
+    static char buf[32];
+
+    if (offset >= -256)
+    {
+        snprintf(buf, sizeof(buf), "[x29, #%d]", offset);
+        return buf;
+    }
+    if (-offset <= 4095)
+    {
+        fprintf(OutFile, "\tsub x16, x29, #%d\n", -offset);
+    }
+    else
+    {
+        fprintf(OutFile, "\tmov x16, #%d\n", -offset);
+        fprintf(OutFile, "\tsub x16, x29, x16\n");
+    }
+    return "[x16]";
+}
+
 /**
  * Loads a local variable from the stack into a register.
  *
@@ -276,13 +355,13 @@ static int load_local(Symbol *sym)
     switch (sym->size)
     {
     case 1:
-        fprintf(OutFile, "\tldrb %s, [x29, #%d]\n", wreglist[r], sym->offset); // 1 Byte
+        fprintf(OutFile, "\tldrb %s, %s\n", wreglist[r], frame_addr(sym->offset)); // 1 Byte
         break;
     case 4:
-        fprintf(OutFile, "\tldrsw %s, [x29, #%d]\n", reglist[r], sym->offset); // 4 Bytes
+        fprintf(OutFile, "\tldrsw %s, %s\n", reglist[r], frame_addr(sym->offset)); // 4 Bytes
         break;
     default:
-        fprintf(OutFile, "\tldr %s, [x29, #%d]\n", reglist[r], sym->offset); // 8 Bytes
+        fprintf(OutFile, "\tldr %s, %s\n", reglist[r], frame_addr(sym->offset)); // 8 Bytes
         break;
     }
     return r;
@@ -300,13 +379,13 @@ static int store_local(int r, Symbol *sym)
     switch (sym->size)
     {
     case 1:
-        fprintf(OutFile, "\tstrb %s, [x29, #%d]\n", wreglist[r], sym->offset); // 1 Byte
+        fprintf(OutFile, "\tstrb %s, %s\n", wreglist[r], frame_addr(sym->offset)); // 1 Byte
         break;
     case 4:
-        fprintf(OutFile, "\tstr %s, [x29, #%d]\n", wreglist[r], sym->offset); // 4 Bytes
+        fprintf(OutFile, "\tstr %s, %s\n", wreglist[r], frame_addr(sym->offset)); // 4 Bytes
         break;
     default:
-        fprintf(OutFile, "\tstr %s, [x29, #%d]\n", reglist[r], sym->offset); // 8 Bytes
+        fprintf(OutFile, "\tstr %s, %s\n", reglist[r], frame_addr(sym->offset)); // 8 Bytes
         break;
     }
     return r;
@@ -329,13 +408,13 @@ static void store_param(int idx, Symbol *sym)
     switch (sym->size)
     {
     case 1:
-        fprintf(OutFile, "\tstrb w%d, [x29, #%d]\n", idx, sym->offset); // 1 Byte
+        fprintf(OutFile, "\tstrb w%d, %s\n", idx, frame_addr(sym->offset)); // 1 Byte
         break;
     case 4:
-        fprintf(OutFile, "\tstr w%d, [x29, #%d]\n", idx, sym->offset); // 4 Bytes
+        fprintf(OutFile, "\tstr w%d, %s\n", idx, frame_addr(sym->offset)); // 4 Bytes
         break;
     default:
-        fprintf(OutFile, "\tstr x%d, [x29, #%d]\n", idx, sym->offset); // 8 Bytes
+        fprintf(OutFile, "\tstr x%d, %s\n", idx, frame_addr(sym->offset)); // 8 Bytes
         break;
     }
 }
@@ -366,6 +445,7 @@ static void store_result(int r)
 
 // Control flow
 static int _label = 0;
+static int PowLabel = NO_LABEL; // Exponentiation routine, emitted by end() once it is used
 
 /**
  * Generates a new, unique label ID.
@@ -408,6 +488,34 @@ static void jump_cond(int r, int l)
     fprintf(OutFile, "\tcbz %s, L%d\n", reglist[r], l);
 }
 
+/**
+ * Generates a conditional branch if a register is not zero.
+ *
+ * @param r The index of the register to check
+ * @param l The destination label ID if the condition is met
+ */
+static void jump_true(int r, int l)
+{
+    fprintf(OutFile, "\tcbnz %s, L%d\n", reglist[r], l);
+}
+
+/**
+ * Copies a register into another one, used to merge values coming from different branches.
+ *
+ * @param src Index of the register to copy, it is freed
+ * @param dst Index of the destination register
+ * @return The destination register
+ */
+static int move(int src, int dst)
+{
+    if (src != dst)
+    {
+        fprintf(OutFile, "\tmov %s, %s\n", reglist[dst], reglist[src]);
+        free_register(src);
+    }
+    return dst;
+}
+
 // Arithmetic operations
 /**
  * Performs numerical negation.
@@ -498,41 +606,326 @@ static int mod(int r1, int r2)
 }
 
 /**
- * Implements integer exponentiation.
+ * Finds the exponent of a power of two.
  *
- * @param r1 Index of the base register
- * @param r2 Index of the exponent register
- * @return The index of the register containing the power result
+ * @param c The number
+ * @return k if c is 2^k, -1 otherwise
  */
-static int pow(int r1, int r2)
+static int exact_log2(unsigned long long c)
 {
-    int Lloop = label();
-    int Lend = label();
-    int r_res = alloc_register();
+    int k = 0;
 
-    // Initialize result to 1
-    fprintf(OutFile, "\tmov %s, #1\n", reglist[r_res]);
+    if (c == 0 || (c & (c - 1)) != 0)
+    {
+        return -1;
+    }
+    while (c > 1)
+    {
+        c >>= 1;
+        k++;
+    }
+    return k;
+}
 
-    genlabel(Lloop);
-    // If exponent is 0, we are done
-    fprintf(OutFile, "\tcbz %s, L%d\n", reglist[r2], Lend);
+/**
+ * Loads a 64-bit constant into a register, one half-word at a time.
+ *
+ * @param r Index of the register
+ * @param val The constant
+ */
+static void load_wide(int r, long long val)
+{
+    unsigned long long u = (unsigned long long)val;
 
-    // res = res * base
-    fprintf(OutFile, "\tmul %s, %s, %s\n", reglist[r_res], reglist[r_res], reglist[r1]);
-    // exp--
-    fprintf(OutFile, "\tsub %s, %s, #1\n", reglist[r2], reglist[r2]);
+    fprintf(OutFile, "\tmovz %s, #%llu\n", reglist[r], u & 0xffff);
+    for (int k = 16; k < 64; k += 16)
+    {
+        if ((u >> k) & 0xffff)
+        {
+            fprintf(OutFile, "\tmovk %s, #%llu, lsl #%d\n", reglist[r], (u >> k) & 0xffff, k);
+        }
+    }
+}
 
-    jump(Lloop);
+/**
+ * Finds the magic number of a signed division by a constant (Hacker's Delight, 10-1): the high
+ * half of n * m shifted right by s gives n / d, rounded down.
+ *
+ * @param d The divisor, |d| >= 2 and not a power of two
+ * @param m The multiplier
+ * @param s The shift
+ */
+static void magic(long long d, long long *m, int *s)
+{
+    const unsigned long long two63 = 1ULL << 63;
+    unsigned long long ad = d < 0 ? -(unsigned long long)d : (unsigned long long)d;
+    unsigned long long t = two63 + ((unsigned long long)d >> 63);
+    unsigned long long anc = t - 1 - t % ad; // Absolute value of nc
+    unsigned long long q1 = two63 / anc, r1 = two63 - q1 * anc;
+    unsigned long long q2 = two63 / ad, r2 = two63 - q2 * ad;
+    unsigned long long delta;
+    int p = 63;
+
+    do
+    {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc)
+        {
+            q1++;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad)
+        {
+            q2++;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    *m = (long long)(q2 + 1);
+    if (d < 0)
+    {
+        *m = -*m;
+    }
+    *s = p - 64;
+}
+
+/**
+ * Multiplies by a constant. Factors of the form 2^k, 2^k + 1 and 2^k - 1, times a power of two,
+ * become shifts and adds, the rest use mul.
+ *
+ * @param r Index of the factor register
+ * @param val The constant factor
+ * @return The same register index containing the product
+ */
+static int mul_const(int r, int val)
+{
+    unsigned long long c = val < 0 ? -(long long)val : val;
+    int shift = 0, negate = val < 0, k;
+
+    if (val == 0)
+    {
+        fprintf(OutFile, "\tmov %s, #0\n", reglist[r]);
+        return r;
+    }
+    while ((c & 1) == 0)
+    {
+        c >>= 1;
+        shift++;
+    }
+
+    if (c == 1)
+    {
+        // Only the shift is left
+    }
+    else if ((k = exact_log2(c - 1)) != -1)
+    {
+        fprintf(OutFile, "\tadd %s, %s, %s, lsl #%d\n", reglist[r], reglist[r], reglist[r], k);
+    }
+    else if ((k = exact_log2(c + 1)) != -1)
+    {
+        // r - (r << k) is the product negated
+        fprintf(OutFile, "\tsub %s, %s, %s, lsl #%d\n", reglist[r], reglist[r], reglist[r], k);
+        negate = !negate;
+    }
+    else
+    {
+        return mul(load_int(val), r);
+    }
+
+    if (shift > 0)
+    {
+        fprintf(OutFile, "\tlsl %s, %s, #%d\n", reglist[r], reglist[r], shift);
+    }
+    if (negate)
+    {
+        fprintf(OutFile, "\tneg %s, %s\n", reglist[r], reglist[r]);
+    }
+    return r;
+}
+
+/**
+ * Divides by a constant rounding toward zero. Powers of two add 2^k - 1 to negative dividends
+ * before shifting, other divisors multiply by their magic number and correct the rounding.
+ *
+ * @param r Index of the dividend register
+ * @param val The constant divisor
+ * @return The same register index containing the quotient
+ */
+static int div_const(int r, int val)
+{
+    long long d = val, m;
+    int k = exact_log2(d < 0 ? -d : d), s, t;
+
+    if (val == 0)
+    {
+        return sdiv(r, load_int(val)); // Left to the hardware, it gives 0
+    }
+    if (val == 1 || val == -1)
+    {
+        return val == 1 ? r : neg(r);
+    }
+
+    t = alloc_register();
+    if (k != -1)
+    {
+        fprintf(OutFile, "\tasr %s, %s, #63\n", reglist[t], reglist[r]);
+        fprintf(OutFile, "\tadd %s, %s, %s, lsr #%d\n", reglist[r], reglist[r], reglist[t], 64 - k);
+        fprintf(OutFile, "\tasr %s, %s, #%d\n", reglist[r], reglist[r], k);
+        free_register(t);
+        return d < 0 ? neg(r) : r;
+    }
+
+    magic(d, &m, &s);
+    load_wide(t, m);
+    fprintf(OutFile, "\tsmulh %s, %s, %s\n", reglist[t], reglist[r], reglist[t]);
+    if (d > 0 && m < 0)
+    {
+        fprintf(OutFile, "\tadd %s, %s, %s\n", reglist[t], reglist[t], reglist[r]);
+    }
+    else if (d < 0 && m > 0)
+    {
+        fprintf(OutFile, "\tsub %s, %s, %s\n", reglist[t], reglist[t], reglist[r]);
+    }
+    if (s > 0)
+    {
+        fprintf(OutFile, "\tasr %s, %s, #%d\n", reglist[t], reglist[t], s);
+    }
+    // Rounded down so far, a negative quotient goes up by one
+    fprintf(OutFile, "\tadd %s, %s, %s, lsr #63\n", reglist[r], reglist[t], reglist[t]);
+    free_register(t);
+    return r;
+}
+
+/**
+ * Calculates the remainder of a division by a constant. Powers of two mask the dividend and
+ * its negation and keep the one with the sign of the dividend, other divisors subtract the
+ * quotient times the divisor.
+ *
+ * @param r Index of the dividend register
+ * @param val The constant divisor
+ * @return The same register index containing the remainder
+ */
+static int mod_const(int r, int val)
+{
+    long long d = val;
+    int k = exact_log2(d < 0 ? -d : d), q, c;
+
+    if (val == 0)
+    {
+        return mod(r, load_int(val));
+    }
+    if (val == 1 || val == -1)
+    {
+        fprintf(OutFile, "\tmov %s, #0\n", reglist[r]);
+        return r;
+    }
+
+    q = alloc_register();
+    if (k != -1)
+    {
+        fprintf(OutFile, "\tnegs %s, %s\n", reglist[q], reglist[r]);
+        fprintf(OutFile, "\tand %s, %s, #%lld\n", reglist[r], reglist[r], (1LL << k) - 1);
+        fprintf(OutFile, "\tand %s, %s, #%lld\n", reglist[q], reglist[q], (1LL << k) - 1);
+        fprintf(OutFile, "\tcsneg %s, %s, %s, mi\n", reglist[r], reglist[r], reglist[q]);
+        free_register(q);
+        return r;
+    }
 
-    genlabel(Lend);
-    // Copy final result to r2
-    fprintf(OutFile, "\tmov %s, %s\n", reglist[r2], reglist[r_res]);
+    fprintf(OutFile, "\tmov %s, %s\n", reglist[q], reglist[r]);
+    q = div_const(q, val);
+    c = load_int(val);
+    fprintf(OutFile, "\tmsub %s, %s, %s, %s\n", reglist[r], reglist[q], reglist[c], reglist[r]);
+    free_register(q);
+    free_register(c);
+    return r;
+}
 
+/**
+ * Implements integer exponentiation with a call to the routine emitted by end().
+ *
+ * @param r1 Index of the base register
+ * @param r2 Index of the exponent register
+ * @return The index of the register containing the power result
+ */
+static int pow(int r1, int r2)
+{
+    if (PowLabel == NO_LABEL)
+    {
+        PowLabel = label();
+    }
+    // Only x0-x2 are touched, the temporaries survive the call
+    fprintf(OutFile, "\tmov x0, %s\n", reglist[r1]);
+    fprintf(OutFile, "\tmov x1, %s\n", reglist[r2]);
+    fprintf(OutFile, "\tbl L%d\n", PowLabel);
+    fprintf(OutFile, "\tmov %s, x0\n", reglist[r2]);
     free_register(r1);
-    free_register(r_res);
     return r2;
 }
 
+/**
+ * Raises to a constant power with a square-and-multiply chain, the bits of the exponent are
+ * read from the highest one down. A negative exponent goes to the routine.
+ *
+ * @param r Index of the base register
+ * @param val The constant exponent
+ * @return The index of the register containing the power result
+ */
+static int pow_const(int r, int val)
+{
+    int top = 30, base = NO_REG;
+
+    if (val < 0)
+    {
+        return pow(r, load_int(val));
+    }
+    if (val == 0)
+    {
+        fprintf(OutFile, "\tmov %s, #1\n", reglist[r]);
+        return r;
+    }
+
+    // The base is only needed again if a bit below the highest one is set
+    while (!(val >> top & 1))
+    {
+        top--;
+    }
+    if (val & ((1 << top) - 1))
+    {
+        base = alloc_register();
+        fprintf(OutFile, "\tmov %s, %s\n", reglist[base], reglist[r]);
+    }
+    for (int k = top - 1; k >= 0; k--)
+    {
+        fprintf(OutFile, "\tmul %s, %s, %s\n", reglist[r], reglist[r], reglist[r]);
+        if (val >> k & 1)
+        {
+            fprintf(OutFile, "\tmul %s, %s, %s\n", reglist[r], reglist[r], reglist[base]);
+        }
+    }
+    if (base != NO_REG)
+    {
+        free_register(base);
+    }
+    return r;
+}
+
+/**
+ * Sign extends the low 32 bits of a register, the value an int keeps once stored.
+ *
+ * @param r Index of the register
+ * @return The same register index containing the extended value
+ */
+static int sext(int r)
+{
+    fprintf(OutFile, "\tsxtw %s, %s\n", reglist[r], wreglist[r]);
+    return r;
+}
+
 // Logic operations
 /**
  * Performs a logical NOT operation on a boolean value.
@@ -546,49 +939,247 @@ static int not(int r)
     return r;
 }
 
+// Comparison operations
+static char *const conds[] = {"eq", "ne", "lt", "ge", "gt", "le"};
+
 /**
- * Performs a bitwise/logical AND operation between two registers.
+ * Performs a comparison between two registers and sets a boolean result.
  *
  * @param r1 Index of the first operand register
  * @param r2 Index of the second operand register
- * @return The index of the register containing the result
+ * @param cond Condition that gives true
+ * @return The index of the register containing the boolean result
  */
-static int and(int r1, int r2)
+static int cmp(int r1, int r2, Cond cond)
 {
-    fprintf(OutFile, "\tand %s, %s, %s\n", reglist[r2], reglist[r1], reglist[r2]);
+    fprintf(OutFile, "\tcmp %s, %s\n", reglist[r1], reglist[r2]);
+    fprintf(OutFile, "\tcset %s, %s\n", reglist[r2], conds[cond]);
     free_register(r1);
     return r2;
 }
 
 /**
- * Performs a bitwise/logical OR operation between two registers.
+ * Compares two registers and branches on the flags, without building a boolean.
  *
- * @param r1 Index of the first operand register
- * @param r2 Index of the second operand register
- * @return The index of the register containing the result
+ * @param r1 Index of the first operand register, it is freed
+ * @param r2 Index of the second operand register, it is freed
+ * @param cond Condition that takes the branch
+ * @param l The destination label ID
  */
-static int or(int r1, int r2)
+static void cmp_jump(int r1, int r2, Cond cond, int l)
 {
-    fprintf(OutFile, "\torr %s, %s, %s\n", reglist[r2], reglist[r1], reglist[r2]);
+    fprintf(OutFile, "\tcmp %s, %s\n", reglist[r1], reglist[r2]);
+    fprintf(OutFile, "\tb.%s L%d\n", conds[cond], l);
     free_register(r1);
-    return r2;
+    free_register(r2);
 }
 
-// Comparison operations
 /**
- * Performs a comparison between two registers and sets a boolean result.
+ * Compares a register with a constant and branches. Against zero, equality becomes cbz/cbnz and
+ * the sign becomes a test of bit 63, other constants fit the immediate of cmp or cmn when they can.
  *
- * @param r1 Index of the first operand register
- * @param r2 Index of the second operand register
- * @param cond ARM64 condition code string ("eq", "ne", "lt", "gt", "le", "ge")
- * @return The index of the register containing the boolean result
+ * @param r Index of the register, it is freed
+ * @param val The constant
+ * @param cond Condition that takes the branch
+ * @param l The destination label ID
  */
-static int cmp(int r1, int r2, char *cond)
+static void cmp_jump_const(int r, int val, Cond cond, int l)
 {
-    fprintf(OutFile, "\tcmp %s, %s\n", reglist[r1], reglist[r2]);
-    fprintf(OutFile, "\tcset %s, %s\n", reglist[r2], cond);
-    free_register(r1);
-    return r2;
+    if (val == 0 && cond != C_GT && cond != C_LE)
+    {
+        static char *const zero[] = {"cbz", "cbnz", "tbnz", "tbz"};
+
+        fprintf(OutFile, "\t%s %s, %sL%d\n", zero[cond], reglist[r], cond == C_LT || cond == C_GE ? "#63, " : "", l);
+    }
+    else if (val >= 0 && val <= 4095)
+    {
+        fprintf(OutFile, "\tcmp %s, #%d\n", reglist[r], val);
+        fprintf(OutFile, "\tb.%s L%d\n", conds[cond], l);
+    }
+    else if (val < 0 && val >= -4095)
+    {
+        fprintf(OutFile, "\tcmn %s, #%d\n", reglist[r], -val);
+        fprintf(OutFile, "\tb.%s L%d\n", conds[cond], l);
+    }
+    else
+    {
+        cmp_jump(r, load_int(val), cond, l);
+        return;
+    }
+    free_register(r);
+}
+
+/**
+ * Tests a single bit of a register and branches.
+ *
+ * @param r Index of the register, it is freed
+ * @param bit Number of the bit
+ * @param cond C_EQ branches when the bit is clear, C_NE when it is set
+ * @param l The destination label ID
+ */
+static void bit_jump(int r, int bit, Cond cond, int l)
+{
+    fprintf(OutFile, "\t%s %s, #%d, L%d\n", cond == C_EQ ? "tbz" : "tbnz", reglist[r], bit, l);
+    free_register(r);
+}
+
+/**
+ * Compares a register with a constant, leaving the result in the flags.
+ *
+ * @param r Index of the register, it is kept
+ * @param val The constant
+ */
+static void cmp_const(int r, int val)
+{
+    if (val >= 0 && val <= 4095)
+    {
+        fprintf(OutFile, "\tcmp %s, #%d\n", reglist[r], val);
+    }
+    else if (val < 0 && val >= -4095)
+    {
+        fprintf(OutFile, "\tcmn %s, #%d\n", reglist[r], -val);
+    }
+    else
+    {
+        int t = load_int(val);
+
+        fprintf(OutFile, "\tcmp %s, %s\n", reglist[r], reglist[t]);
+        free_register(t);
+    }
+}
+
+/**
+ * Jumps through a table indexed by the distance to the lowest value, values in between that no
+ * case takes go to the default. The table holds offsets from itself, so it needs no relocation
+ * at load time and lives with the read-only data.
+ *
+ * @param r Index of the register, it is kept
+ * @param vals Case values, sorted
+ * @param labels Label of every case
+ * @param n Number of cases
+ * @param deflt Label taken by the other values
+ */
+static void jump_table(int r, int *vals, int *labels, int n, int deflt)
+{
+    int t = alloc_register(), u = alloc_register(), table = label();
+    int span = vals[n - 1] - vals[0];
+
+    if (vals[0] >= 0 && vals[0] <= 4095)
+    {
+        fprintf(OutFile, "\tsub %s, %s, #%d\n", reglist[t], reglist[r], vals[0]);
+    }
+    else if (vals[0] < 0 && vals[0] >= -4095)
+    {
+        fprintf(OutFile, "\tadd %s, %s, #%d\n", reglist[t], reglist[r], -vals[0]);
+    }
+    else
+    {
+        int low = load_int(vals[0]);
+
+        fprintf(OutFile, "\tsub %s, %s, %s\n", reglist[t], reglist[r], reglist[low]);
+        free_register(low);
+    }
+    // Unsigned, values under the lowest one wrap around past the end
+    fprintf(OutFile, "\tcmp %s, #%d\n", reglist[t], span);
+    fprintf(OutFile, "\tb.hi L%d\n", deflt);
+    fprintf(OutFile, "\tadrp %s, L%d@PAGE\n", reglist[u], table);
+    fprintf(OutFile, "\tadd %s, %s, L%d@PAGEOFF\n", reglist[u], reglist[u], table);
+    fprintf(OutFile, "\tldrsw %s, [%s, %s, lsl #2]\n", reglist[t], reglist[u], reglist[t]);
+    fprintf(OutFile, "\tadd %s, %s, %s\n", reglist[u], reglist[u], reglist[t]);
+    fprintf(OutFile, "\tbr %s\n", reglist[u]);
+
+    fprintf(OutFile, "\t.section __TEXT,__const\n");
+    fprintf(OutFile, "\t.p2align 2\n");
+    genlabel(table);
+    for (int i = 0, k = 0; i <= span; i++)
+    {
+        int l = vals[k] - vals[0] == i ? labels[k++] : deflt;
+
+        fprintf(OutFile, "\t.long L%d-L%d\n", l, table);
+    }
+    fprintf(OutFile, "\t.text\n");
+    free_register(t);
+    free_register(u);
+}
+
+/**
+ * Emits the dispatch of a range of sorted cases. Dense ranges become a jump table, short ones a
+ * row of compares, and the rest is split in two halves by the compare against the middle case.
+ *
+ * @param r Index of the register, it is kept
+ * @param vals Case values, sorted
+ * @param labels Label of every case
+ * @param n Number of cases
+ * @param deflt Label taken by the other values
+ */
+static void switch_range(int r, int *vals, int *labels, int n, int deflt)
+{
+    int mid = n / 2, right;
+
+    // A table pays off once it replaces a few compares and a third of its entries are cases
+    if (n >= 4)
+    {
+        long span = (long)vals[n - 1] - vals[0] + 1;
+
+        if (span <= 4096 && span <= n * 3L)
+        {
+            jump_table(r, vals, labels, n, deflt);
+            return;
+        }
+    }
+    if (n <= 3)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            cmp_const(r, vals[i]);
+            fprintf(OutFile, "\tb.eq L%d\n", labels[i]);
+        }
+        jump(deflt);
+        return;
+    }
+    right = label();
+    cmp_const(r, vals[mid]);
+    fprintf(OutFile, "\tb.eq L%d\n", labels[mid]);
+    fprintf(OutFile, "\tb.gt L%d\n", right);
+    switch_range(r, vals, labels, mid, deflt);
+    genlabel(right);
+    switch_range(r, vals + mid + 1, labels + mid + 1, n - mid - 1, deflt);
+}
+
+/**
+ * Jumps to the label of the case matching a register, or to the default.
+ *
+ * @param r Index of the register, it is freed
+ * @param vals Case values, all different
+ * @param labels Label of every case
+ * @param n Number of cases
+ * @param deflt Label taken by the other values
+ */
+static void switch_jump(int r, int *vals, int *labels, int n, int deflt)
+{
+    // Only a default, nothing to compare
+    if (n == 0)
+    {
+        jump(deflt);
+        free_register(r);
+        return;
+    }
+
+    // Insertion sort, matches are short
+    for (int i = 1; i < n; i++)
+    {
+        int v = vals[i], l = labels[i], j = i;
+
+        for (; j > 0 && vals[j - 1] > v; j--)
+        {
+            vals[j] = vals[j - 1];
+            labels[j] = labels[j - 1];
+        }
+        vals[j] = v;
+        labels[j] = l;
+    }
+    switch_range(r, vals, labels, n, deflt);
+    free_register(r);
 }
 
 // IO
@@ -677,6 +1268,54 @@ static void print(int r)
     fprintf(OutFile, "\tadd sp, sp, #32\n");
 }
 
+// Runtime
+/**
+ * Emits the runtime routines the code used, after everything else.
+ */
+static void end(void)
+{
+    int Lloop, Lskip, Ldone, Lneg, Lminus;
+
+    if (PowLabel == NO_LABEL)
+    {
+        return;
+    }
+    Lloop = label();
+    Lskip = label();
+    Ldone = label();
+    Lneg = label();
+    Lminus = label();
+
+    // x0 = x0 ** x1 by squaring, one step per bit of the exponent
+    genlabel(PowLabel);
+    fprintf(OutFile, "\ttbnz x1, #63, L%d\n", Lneg);
+    fprintf(OutFile, "\tmov x2, x0\n");
+    fprintf(OutFile, "\tmov x0, #1\n");
+    genlabel(Lloop);
+    fprintf(OutFile, "\tcbz x1, L%d\n", Ldone);
+    fprintf(OutFile, "\ttbz x1, #0, L%d\n", Lskip);
+    fprintf(OutFile, "\tmul x0, x0, x2\n");
+    genlabel(Lskip);
+    fprintf(OutFile, "\tmul x2, x2, x2\n");
+    fprintf(OutFile, "\tlsr x1, x1, #1\n");
+    jump(Lloop);
+    genlabel(Ldone);
+    fprintf(OutFile, "\tret\n");
+
+    // A negative exponent gives 1 / x0 ** -x1 rounded toward zero: 1 for 1, -1 or 1 for -1, 0 for the rest
+    genlabel(Lneg);
+    fprintf(OutFile, "\tcmn x0, #1\n");
+    fprintf(OutFile, "\tb.eq L%d\n", Lminus);
+    fprintf(OutFile, "\tcmp x0, #1\n");
+    fprintf(OutFile, "\tcset x0, eq\n");
+    fprintf(OutFile, "\tret\n");
+    genlabel(Lminus);
+    fprintf(OutFile, "\ttst x1, #1\n");
+    fprintf(OutFile, "\tmov x0, #1\n");
+    fprintf(OutFile, "\tcneg x0, x0, ne\n");
+    fprintf(OutFile, "\tret\n");
+}
+
 // Interface definition
 struct Backend ARM64_Backend = {
     .freeall_registers = freeall_registers,
@@ -684,11 +1323,13 @@ struct Backend ARM64_Backend = {
     .alloc_register = alloc_register,
     .data_seg = data_seg,
     .text_seg = text_seg,
+    .end = end,
     .globsym = globsym,
     .genfunlabel = genfunlabel,
     .preamble = preamble,
     .postamble = postamble,
     .call = call,
+    .tail_call = tail_call,
     .ret = ret,
     .load_int = load_int,
     .load_glob = load_glob,
@@ -702,16 +1343,25 @@ struct Backend ARM64_Backend = {
     .genlabel = genlabel,
     .jump = jump,
     .jump_cond = jump_cond,
+    .jump_true = jump_true,
+    .move = move,
     .neg = neg,
     .add = add,
     .sub = sub,
     .mul = mul,
     .div = sdiv,
     .mod = mod,
+    .mul_const = mul_const,
+    .div_const = div_const,
+    .mod_const = mod_const,
     .pow = pow,
+    .pow_const = pow_const,
+    .sext = sext,
     .not = not,
-    .and = and,
-    .or = or,
     .cmp = cmp,
+    .cmp_jump = cmp_jump,
+    .cmp_jump_const = cmp_jump_const,
+    .bit_jump = bit_jump,
+    .switch_jump = switch_jump,
     .print = print,
 };
@@ -15,6 +15,16 @@
 #include "data.h"
 #include "decl.h"
 
+static Control *FreeControls = NULL; // Popped entries, reused by push_flow()
+static ASTnode **Defs = NULL;        // Every function definition, nested ones included
+static int NumDefs = 0;
+static int MaxDefs = 0;
+static char *Reached = NULL;         // Definitions called from the top level, directly or not
+static IRprogram *Program = NULL;    // IR of the functions, NULL on the direct path
+
+// Condition of every comparison node, in the order they follow A_EQ
+static const Cond Conds[] = {C_EQ, C_NE, C_LT, C_LE, C_GT, C_GE};
+
 /**
  * Pushes a new control context onto the stack.
  *
@@ -23,12 +33,15 @@
  */
 static void push_flow(int start, int end)
 {
-    Control *c = (Control *)malloc(sizeof(Control));
+    Control *c = FreeControls;
 
-    if (!c)
+    if (c != NULL)
     {
-        fprintf(stderr, "Fatal Error: out of memory\n");
-        exit(1);
+        FreeControls = c->next;
+    }
+    else
+    {
+        c = (Control *)arena_alloc(&GenArena, sizeof(Control));
     }
     c->start_label = start;
     c->end_label = end;
@@ -37,7 +50,7 @@ static void push_flow(int start, int end)
 }
 
 /**
- * Pops the top context from the stack.
+ * Pops the top context from the stack, the entry is kept for the next push.
  */
 static void pop_flow(void)
 {
@@ -49,7 +62,8 @@ static void pop_flow(void)
     Control *tmp = CurrentControl;
 
     CurrentControl = CurrentControl->next;
-    free(tmp);
+    tmp->next = FreeControls;
+    FreeControls = tmp;
 }
 
 /**
@@ -132,7 +146,7 @@ static void genGlobs(Symbol *s)
 {
     while (s != NULL)
     {
-        if (s->stype == S_CONSTANT || s->stype == S_VARIABLE)
+        if ((s->stype == S_CONSTANT || s->stype == S_VARIABLE) && s->sclass != C_IMMEDIATE)
         {
             CG->globsym(s);
         }
@@ -140,6 +154,318 @@ static void genGlobs(Symbol *s)
     }
 }
 
+static int genAST(ASTnode *n);
+static void genJumpTrue(ASTnode *n, int l);
+
+/**
+ * Evaluates the arguments of a call and moves them to the argument registers.
+ *
+ * @param n The call
+ */
+static void genArgs(ASTnode *n)
+{
+    ASTnode *arg = AST_LEFT(n);
+    int regs[8];
+    int idx = 0;
+
+    while (arg)
+    {
+        regs[idx] = genAST(AST_LEFT(arg));
+        idx++;
+        arg = AST_RIGHT(arg);
+    }
+    // Load args
+    for (int i = 0; i < idx; i++)
+    {
+        CG->load_arg(regs[i], i);
+        CG->free_register(regs[i]);
+    }
+}
+
+/**
+ * Code generation for a comparison in branch context, the flags decide the branch and no 0/1
+ * value is built. With optimizations a literal right operand becomes an immediate, and the
+ * parity test x % 2 == 0 becomes a test of bit 0.
+ *
+ * @param n The comparison
+ * @param cond Condition that takes the branch, already inverted when jumping on false
+ * @param l Label to jump to
+ */
+static void genCmpJump(ASTnode *n, Cond cond, int l)
+{
+    ASTnode *left = AST_LEFT(n), *right = AST_RIGHT(n);
+
+    if (OptLevel > 0 && right->type == A_INTLIT)
+    {
+        int val = AST_VALUE(right).integer;
+
+        if (val == 0 && (cond == C_EQ || cond == C_NE) && left->type == A_MOD &&
+            AST_RIGHT(left)->type == A_INTLIT && AST_VALUE(AST_RIGHT(left)).integer == 2)
+        {
+            CG->bit_jump(genAST(AST_LEFT(left)), 0, cond, l);
+            return;
+        }
+        CG->cmp_jump_const(genAST(left), val, cond, l);
+        return;
+    }
+    int leftReg = genAST(left);
+    int rightReg = genAST(right);
+
+    CG->cmp_jump(leftReg, rightReg, cond, l);
+}
+
+/**
+ * Code generation for a condition in branch context, jumps when it is false and falls through
+ * when it is true. && and || never materialize a 0/1 value here.
+ *
+ * @param n The boolean expression
+ * @param l Label to jump to when the expression is false
+ */
+static void genJumpFalse(ASTnode *n, int l)
+{
+    switch (n->type)
+    {
+    case A_TRUE:
+        return;
+    case A_FALSE:
+        CG->jump(l);
+        return;
+    case A_NOT:
+        genJumpTrue(AST_LEFT(n), l);
+        return;
+    case A_AND:
+        genJumpFalse(AST_LEFT(n), l);
+        genJumpFalse(AST_RIGHT(n), l);
+        return;
+    case A_OR:
+    {
+        int Ltrue = CG->label();
+
+        genJumpTrue(AST_LEFT(n), Ltrue);
+        genJumpFalse(AST_RIGHT(n), l);
+        CG->genlabel(Ltrue);
+        return;
+    }
+    case A_EQ:
+    case A_NEQ:
+    case A_LT:
+    case A_GT:
+    case A_LE:
+    case A_GE:
+        genCmpJump(n, Conds[n->type - A_EQ] ^ 1, l);
+        return;
+    default:
+    {
+        int r = genAST(n);
+
+        CG->jump_cond(r, l);
+        CG->free_register(r);
+        return;
+    }
+    }
+}
+
+/**
+ * Code generation for a condition in branch context, jumps when it is true and falls through
+ * when it is false.
+ *
+ * @param n The boolean expression
+ * @param l Label to jump to when the expression is true
+ */
+static void genJumpTrue(ASTnode *n, int l)
+{
+    switch (n->type)
+    {
+    case A_TRUE:
+        CG->jump(l);
+        return;
+    case A_FALSE:
+        return;
+    case A_NOT:
+        genJumpFalse(AST_LEFT(n), l);
+        return;
+    case A_OR:
+        genJumpTrue(AST_LEFT(n), l);
+        genJumpTrue(AST_RIGHT(n), l);
+        return;
+    case A_AND:
+    {
+        int Lfalse = CG->label();
+
+        genJumpFalse(AST_LEFT(n), Lfalse);
+        genJumpTrue(AST_RIGHT(n), l);
+        CG->genlabel(Lfalse);
+        return;
+    }
+    case A_EQ:
+    case A_NEQ:
+    case A_LT:
+    case A_GT:
+    case A_LE:
+    case A_GE:
+        genCmpJump(n, Conds[n->type - A_EQ], l);
+        return;
+    default:
+    {
+        int r = genAST(n);
+
+        CG->jump_true(r, l);
+        CG->free_register(r);
+        return;
+    }
+    }
+}
+
+/**
+ * Code generation for && and || as values, the right side only runs when the left one does
+ * not decide the result.
+ *
+ * @param left Register holding the left operand, it also receives the result
+ * @param right The right operand
+ * @param isAnd 1 for &&, 0 for ||
+ * @return The register containing the result
+ */
+static int genShortCircuit(int left, ASTnode *right, int isAnd)
+{
+    int Lend = CG->label();
+
+    // The left value already is the result when it decides
+    if (isAnd)
+    {
+        CG->jump_cond(left, Lend);
+    }
+    else
+    {
+        CG->jump_true(left, Lend);
+    }
+    left = CG->move(genAST(right), left);
+    CG->genlabel(Lend);
+    return left;
+}
+
+/**
+ * Generates a multiplication, division, modulo or power. With optimizations a literal right
+ * operand goes to the backend as a constant, which turns it into shifts, a multiply by the
+ * reciprocal or a chain of multiplies.
+ *
+ * @param type A_MUL, A_DIV, A_MOD or A_POW
+ * @param left Left operand
+ * @param right Right operand
+ * @return Register number containing the result
+ */
+static int genByConst(int type, ASTnode *left, ASTnode *right)
+{
+    if (OptLevel > 0 && right->type == A_INTLIT)
+    {
+        int val = AST_VALUE(right).integer;
+
+        switch (type)
+        {
+        case A_MUL:
+            return CG->mul_const(genAST(left), val);
+        case A_DIV:
+            return CG->div_const(genAST(left), val);
+        case A_POW:
+            return CG->pow_const(genAST(left), val);
+        default:
+            return CG->mod_const(genAST(left), val);
+        }
+    }
+
+    // Left before right, as the IR does
+    int leftReg = genAST(left);
+    int rightReg = genAST(right);
+
+    switch (type)
+    {
+    case A_MUL:
+        return CG->mul(leftReg, rightReg);
+    case A_DIV:
+        return CG->div(leftReg, rightReg);
+    case A_POW:
+        return CG->pow(leftReg, rightReg);
+    default:
+        return CG->mod(leftReg, rightReg);
+    }
+}
+
+/**
+ * Generates a match whose cases are constants. The scrutinee is evaluated once and jumps to the
+ * first case with its value. After a body the match goes on with the next case of the same
+ * value, or the default, which is what testing the remaining cases would find.
+ *
+ * @param n The match node
+ * @param Lend Label after the match
+ */
+static void genSwitch(ASTnode *n, int Lend)
+{
+    ASTnode *c;
+    int count = 0, nvals = 0, i = 0, Ldefault = Lend, r;
+    int *labels, *vals, *targets;
+
+    for (c = AST_RIGHT(n); c != NULL; c = AST_RIGHT(c))
+    {
+        count++;
+    }
+    labels = (int *)malloc((count + 1) * sizeof(int));
+    vals = (int *)malloc((count + 1) * sizeof(int));
+    targets = (int *)malloc((count + 1) * sizeof(int));
+    if (labels == NULL || vals == NULL || targets == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+
+    // The first case of every value takes the jump, the default comes last
+    for (c = AST_RIGHT(n); c != NULL; c = AST_RIGHT(c), i++)
+    {
+        int j = 0;
+
+        labels[i] = CG->label();
+        if (AST_LEFT(c) == NULL)
+        {
+            Ldefault = labels[i];
+            continue;
+        }
+        while (j < nvals && vals[j] != const_value(AST_LEFT(c)))
+        {
+            j++;
+        }
+        if (j == nvals)
+        {
+            vals[nvals] = const_value(AST_LEFT(c));
+            targets[nvals++] = labels[i];
+        }
+    }
+    r = genAST(AST_LEFT(n));
+    CG->switch_jump(r, vals, targets, nvals, Ldefault);
+
+    for (c = AST_RIGHT(n), i = 0; c != NULL; c = AST_RIGHT(c), i++)
+    {
+        int next = Ldefault == labels[i] ? Lend : Ldefault, k = i + 1;
+
+        for (ASTnode *d = AST_RIGHT(c); d != NULL && AST_LEFT(c) != NULL; d = AST_RIGHT(d), k++)
+        {
+            if (AST_LEFT(d) != NULL && const_value(AST_LEFT(d)) == const_value(AST_LEFT(c)))
+            {
+                next = labels[k];
+                break;
+            }
+        }
+        CG->genlabel(labels[i]);
+        genAST(AST_MID(c));
+        CG->freeall_registers();
+        if (next != (AST_RIGHT(c) != NULL ? labels[i + 1] : Lend))
+        {
+            CG->jump(next);
+        }
+    }
+    CG->genlabel(Lend);
+    free(labels);
+    free(vals);
+    free(targets);
+}
+
 /**
  * Code generation for Abstract Syntax Tree.
  *
@@ -157,89 +483,116 @@ static int genAST(ASTnode *n)
     {
     // Literals
     case A_INTLIT:
-        return CG->load_int(n->value.integer);
+        return CG->load_int(AST_VALUE(n).integer);
     case A_TRUE:
         return CG->load_int(1);
     case A_FALSE:
         return CG->load_int(0);
     // Identifiers
     case A_IDENT:
-        return load_var(n->value.symbol);
+        return load_var(AST_VALUE(n).symbol);
     // Unary operations
     case A_POS:
-        return genAST(n->left);
+        return genAST(AST_LEFT(n));
     case A_NEG:
-        return CG->neg(genAST(n->left));
+        return CG->neg(genAST(AST_LEFT(n)));
     case A_NOT:
-        return CG->not(genAST(n->left));
+        return CG->not(genAST(AST_LEFT(n)));
     // Binary operations
     case A_ADD:
-        return CG->add(genAST(n->left), genAST(n->right));
     case A_SUB:
-        return CG->sub(genAST(n->left), genAST(n->right));
+    {
+        // Left before right, a call on one side may change a variable read by the other
+        int leftReg = genAST(AST_LEFT(n));
+        int rightReg = genAST(AST_RIGHT(n));
+
+        return n->type == A_ADD ? CG->add(leftReg, rightReg) : CG->sub(leftReg, rightReg);
+    }
     case A_MUL:
-        return CG->mul(genAST(n->left), genAST(n->right));
+        // A literal factor goes to the right, where it can become shifts
+        if (OptLevel > 0 && AST_LEFT(n)->type == A_INTLIT && AST_RIGHT(n)->type != A_INTLIT)
+        {
+            return genByConst(A_MUL, AST_RIGHT(n), AST_LEFT(n));
+        }
+        return genByConst(A_MUL, AST_LEFT(n), AST_RIGHT(n));
     case A_DIV:
-        return CG->div(genAST(n->left), genAST(n->right));
     case A_MOD:
-        return CG->mod(genAST(n->left), genAST(n->right));
     case A_POW:
-        return CG->pow(genAST(n->left), genAST(n->right));
+        return genByConst(n->type, AST_LEFT(n), AST_RIGHT(n));
     case A_AND:
-        return CG->and(genAST(n->left), genAST(n->right));
+        return genShortCircuit(genAST(AST_LEFT(n)), AST_RIGHT(n), 1);
     case A_OR:
-        return CG->or(genAST(n->left), genAST(n->right));
+        return genShortCircuit(genAST(AST_LEFT(n)), AST_RIGHT(n), 0);
     // Comparisons
     case A_EQ:
-        return CG->cmp(genAST(n->left), genAST(n->right), "eq");
     case A_NEQ:
-        return CG->cmp(genAST(n->left), genAST(n->right), "ne");
     case A_LT:
-        return CG->cmp(genAST(n->left), genAST(n->right), "lt");
     case A_GT:
-        return CG->cmp(genAST(n->left), genAST(n->right), "gt");
     case A_LE:
-        return CG->cmp(genAST(n->left), genAST(n->right), "le");
     case A_GE:
-        return CG->cmp(genAST(n->left), genAST(n->right), "ge");
+    {
+        int leftReg = genAST(AST_LEFT(n));
+        int rightReg = genAST(AST_RIGHT(n));
+
+        return CG->cmp(leftReg, rightReg, Conds[n->type - A_EQ]);
+    }
     // Assignment
     case A_ASSIGN:
-        return store_var(genAST(n->right), n->left->value.symbol);
+        return store_var(genAST(AST_RIGHT(n)), AST_VALUE(AST_LEFT(n)).symbol);
     case A_ASADD:
-        return store_var(CG->add(load_var(n->left->value.symbol), genAST(n->right)), n->left->value.symbol);
     case A_ASSUB:
-        return store_var(CG->sub(load_var(n->left->value.symbol), genAST(n->right)), n->left->value.symbol);
+    {
+        // The variable is read before the right side runs
+        Symbol *sym = AST_VALUE(AST_LEFT(n)).symbol;
+        int leftReg = load_var(sym);
+        int rightReg = genAST(AST_RIGHT(n));
+
+        return store_var(n->type == A_ASADD ? CG->add(leftReg, rightReg) : CG->sub(leftReg, rightReg), sym);
+    }
     case A_ASMUL:
-        return store_var(CG->mul(load_var(n->left->value.symbol), genAST(n->right)), n->left->value.symbol);
+        return store_var(genByConst(A_MUL, AST_LEFT(n), AST_RIGHT(n)), AST_VALUE(AST_LEFT(n)).symbol);
     case A_ASDIV:
-        return store_var(CG->div(load_var(n->left->value.symbol), genAST(n->right)), n->left->value.symbol);
+        return store_var(genByConst(A_DIV, AST_LEFT(n), AST_RIGHT(n)), AST_VALUE(AST_LEFT(n)).symbol);
     case A_ASMOD:
-        return store_var(CG->mod(load_var(n->left->value.symbol), genAST(n->right)), n->left->value.symbol);
+        return store_var(genByConst(A_MOD, AST_LEFT(n), AST_RIGHT(n)), AST_VALUE(AST_LEFT(n)).symbol);
     case A_ASPOW:
-        return store_var(CG->pow(load_var(n->left->value.symbol), genAST(n->right)), n->left->value.symbol);
+        return store_var(genByConst(A_POW, AST_LEFT(n), AST_RIGHT(n)), AST_VALUE(AST_LEFT(n)).symbol);
     case A_ASAND:
-        return store_var(CG->and(load_var(n->left->value.symbol), genAST(n->right)), n->left->value.symbol);
     case A_ASOR:
-        return store_var(CG->or(load_var(n->left->value.symbol), genAST(n->right)), n->left->value.symbol);
+    {
+        // The variable keeps its value when the left side decides
+        Symbol *sym = AST_VALUE(AST_LEFT(n)).symbol;
+        int Lend = CG->label();
+        int r = load_var(sym);
+
+        if (n->type == A_ASAND)
+        {
+            CG->jump_cond(r, Lend);
+        }
+        else
+        {
+            CG->jump_true(r, Lend);
+        }
+        r = store_var(CG->move(genAST(AST_RIGHT(n)), r), sym);
+        CG->genlabel(Lend);
+        return r;
+    }
     // Control flow
     case A_IFELSE:
     {
         int Lfalse = CG->label();
-        int Lend = (n->right) ? CG->label() : Lfalse;
-
-        int cmpReg = genAST(n->left);
+        int Lend = n->right ? CG->label() : Lfalse;
 
-        CG->jump_cond(cmpReg, Lfalse); // Jump if false
-        CG->free_register(cmpReg);
+        genJumpFalse(AST_LEFT(n), Lfalse);
 
-        genAST(n->mid); // True Body
+        genAST(AST_MID(n)); // True Body
         CG->freeall_registers();
 
-        if (n->right)
+        if (AST_RIGHT(n))
         {
             CG->jump(Lend);
             CG->genlabel(Lfalse);
-            genAST(n->right); // False Body
+            genAST(AST_RIGHT(n)); // False Body
             CG->freeall_registers();
         }
         CG->genlabel(Lend);
@@ -248,33 +601,48 @@ static int genAST(ASTnode *n)
     case A_MATCH:
     {
         ASTnode *c;
+        Symbol *match;
         int Lend = CG->label();
 
         // Push match context to stack
         push_flow(NO_LABEL, Lend);
 
+        // Constant cases dispatch on the value
+        if (literal_cases(n))
+        {
+            genSwitch(n, Lend);
+            pop_flow();
+            return NO_REG;
+        }
+
+        // Any other scrutinee is evaluated once into the hidden variable set by the parser
+        match = AST_VALUE(n).symbol;
+        if (match != NULL)
+        {
+            store_var(genAST(AST_LEFT(n)), match);
+            CG->freeall_registers();
+        }
+
         // Iterate cases
-        c = n->right;
+        c = AST_RIGHT(n);
         while (c != NULL)
         {
             int Lnext = CG->label();
 
             // Value check
-            if (c->left)
+            if (AST_LEFT(c))
             {
-                int exprReg = genAST(n->left);
-                int valReg = genAST(c->left);
-                int cmpReg = CG->cmp(exprReg, valReg, "eq");
+                int exprReg = match != NULL ? load_var(match) : genAST(AST_LEFT(n));
+                int valReg = genAST(AST_LEFT(c));
 
-                CG->jump_cond(cmpReg, Lnext);
-                CG->free_register(cmpReg);
+                CG->cmp_jump(exprReg, valReg, C_NE, Lnext);
             }
 
-            genAST(c->mid); // Body
+            genAST(AST_MID(c)); // Body
             CG->freeall_registers();
 
             CG->genlabel(Lnext);
-            c = c->right;
+            c = AST_RIGHT(c);
         }
         CG->genlabel(Lend);
 
@@ -293,27 +661,26 @@ static int genAST(ASTnode *n)
         // Push loop context
         push_flow(Lcontinue, Lend);
 
-        CG->genlabel(Lstart);
+        // Guard, the loop may not run at all
+        genJumpFalse(AST_LEFT(n), Lend);
 
-        // Condition
-        int condReg = genAST(n->left);
-        CG->jump_cond(condReg, Lend);
-        CG->free_register(condReg);
+        CG->genlabel(Lstart);
 
         // Body
-        genAST(n->mid);
+        genAST(AST_MID(n));
         CG->freeall_registers();
 
         CG->genlabel(Lcontinue);
 
         // Update
-        if (n->right)
+        if (AST_RIGHT(n))
         {
-            genAST(n->right);
+            genAST(AST_RIGHT(n));
             CG->freeall_registers();
         }
 
-        CG->jump(Lstart);
+        // Condition at the bottom, the only branch back
+        genJumpTrue(AST_LEFT(n), Lstart);
         CG->genlabel(Lend);
 
         // Pop loop context
@@ -344,85 +711,64 @@ static int genAST(ASTnode *n)
         CG->jump(lbl);
         return NO_REG;
     }
-    // Functions
+    // Functions, emitted after the entry code by genFuncs()
     case A_FUNCTION:
+        return NO_REG;
+    case A_RETURN:
     {
-        int Lskip = CG->label();
-
-        CG->jump(Lskip);
-        CG->genfunlabel(n->value.symbol->name);
-        CG->preamble(n->value.symbol->size);
-
-        // Load params
-        Symbol *param = n->value.symbol->params;
-        int idx = 0;
-
-        // Ensure we only loop up to the number of parameters to avoid grabbing local scope variables
-        while (param != NULL && idx < n->value.symbol->numParams)
+        // A call in tail position hands the frame over to the callee, unless it reads the frame
+        if (AST_LEFT(n) != NULL && AST_LEFT(n)->type == A_CALL &&
+            AST_VALUE(AST_LEFT(n)).symbol->numParams <= 8 &&
+            !is_nested_in(AST_VALUE(AST_LEFT(n)).symbol, AST_VALUE(n).symbol))
         {
-            CG->store_param(idx, param);
-            param = param->next;
-            idx++;
+            genArgs(AST_LEFT(n));
+            CG->tail_call(AST_VALUE(AST_LEFT(n)).symbol->name, AST_VALUE(n).symbol->size);
+            Stats.tailcalls++;
+            return NO_REG;
         }
 
-        // Body
-        genAST(n->left);
-
-        CG->postamble(n->value.symbol->size);
-        CG->genlabel(Lskip);
-        return NO_REG;
-    }
-    case A_RETURN:
-    {
-        int reg = (n->left != NULL) ? genAST(n->left) : NO_REG;
+        int reg = (AST_LEFT(n) != NULL) ? genAST(AST_LEFT(n)) : NO_REG;
 
         CG->ret(reg);
         if (reg != NO_REG)
         {
             CG->free_register(reg);
         }
-        CG->postamble(n->value.symbol->size);
+        CG->postamble(AST_VALUE(n).symbol->size);
         return NO_REG;
     }
     case A_CALL:
     {
-        ASTnode *arg = n->left;
-        int regs[8];
-        int idx = 0;
-
-        while (arg)
-        {
-            regs[idx] = genAST(arg->left);
-            idx++;
-            arg = arg->right;
-        }
-        // Load args
-        for (int i = 0; i < idx; i++)
-        {
-            CG->load_arg(regs[i], i);
-            CG->free_register(regs[i]);
-        }
+        genArgs(n);
+        CG->call(AST_VALUE(n).symbol->name);
 
+        // Allocated after the call, so it is not saved around it
         int r = CG->alloc_register();
 
-        CG->call(n->value.symbol->name);
         CG->store_result(r);
         return r;
     }
     case A_PRINT:
     {
-        int reg = genAST(n->left);
+        int reg = genAST(AST_LEFT(n));
 
         CG->print(reg);
         CG->free_register(reg);
         return NO_REG;
     }
     case A_GLUE:
-        genAST(n->left);
+        genAST(AST_LEFT(n));
         CG->freeall_registers();
-        genAST(n->right);
+        genAST(AST_RIGHT(n));
         CG->freeall_registers();
         return NO_REG;
+    case A_SEQ:
+        for (int i = 0; i < AST_VALUE(n).list->count; i++)
+        {
+            genAST(AST_NODE(AST_VALUE(n).list->item[i]));
+            CG->freeall_registers();
+        }
+        return NO_REG;
     default:
         fprintf(stderr, "Fatal Error: unknown AST Node %d\n", n->type);
         exit(1);
@@ -430,6 +776,210 @@ static int genAST(ASTnode *n)
     return NO_REG;
 }
 
+/**
+ * Generates a function out of line.
+ *
+ * @param n The definition
+ */
+static void genFunction(ASTnode *n)
+{
+    CG->freeall_registers();
+    CG->genfunlabel(AST_VALUE(n).symbol->name);
+    CG->preamble(AST_VALUE(n).symbol->size);
+
+    // Load params
+    Symbol *param = AST_VALUE(n).symbol->params;
+    int idx = 0;
+
+    // Ensure we only loop up to the number of parameters to avoid grabbing local scope variables
+    while (param != NULL && idx < AST_VALUE(n).symbol->numParams)
+    {
+        CG->store_param(idx, param);
+        param = param->next;
+        idx++;
+    }
+
+    // Body
+    genAST(AST_LEFT(n));
+
+    CG->postamble(AST_VALUE(n).symbol->size);
+}
+
+/**
+ * Collects the function definitions of some code, in the order they appear.
+ *
+ * @param n Node of the code
+ */
+static void collectDefs(ASTnode *n)
+{
+    if (n == NULL)
+    {
+        return;
+    }
+    if (n->type == A_SEQ)
+    {
+        for (int i = 0; i < AST_VALUE(n).list->count; i++)
+        {
+            collectDefs(AST_NODE(AST_VALUE(n).list->item[i]));
+        }
+        return;
+    }
+    if (n->type == A_FUNCTION)
+    {
+        if (NumDefs == MaxDefs)
+        {
+            MaxDefs = MaxDefs ? MaxDefs * 2 : 16;
+            Defs = (ASTnode **)arena_grow(&GenArena, Defs, NumDefs * sizeof(ASTnode *), MaxDefs * sizeof(ASTnode *));
+        }
+        Defs[NumDefs++] = n;
+    }
+    collectDefs(AST_LEFT(n));
+    collectDefs(AST_MID(n));
+    collectDefs(AST_RIGHT(n));
+}
+
+static void reachCalls(ASTnode *n);
+
+/**
+ * Marks a function as reached, along with the functions it calls.
+ *
+ * @param sym Function symbol
+ */
+static void reach(Symbol *sym)
+{
+    IRfunc *f = Program != NULL ? ir_callee(Program, sym) : NULL;
+    int i = 0;
+
+    while (i < NumDefs && AST_VALUE(Defs[i]).symbol != sym)
+    {
+        i++;
+    }
+    if (i == NumDefs || Reached[i])
+    {
+        return;
+    }
+    Reached[i] = 1;
+
+    // The optimizer may have removed calls, so the IR has the last word
+    if (f == NULL)
+    {
+        reachCalls(AST_LEFT(Defs[i]));
+        return;
+    }
+    for (int b = 0; b < f->nblocks; b++)
+    {
+        for (IRinstr *in = f->blocks[b]->first; in != NULL; in = in->next)
+        {
+            if (in->op == IR_CALL)
+            {
+                reach(in->sym);
+            }
+        }
+    }
+}
+
+/**
+ * Marks the functions called by some code, leaving out the bodies of nested functions.
+ *
+ * @param n Node of the code
+ */
+static void reachCalls(ASTnode *n)
+{
+    if (n == NULL || n->type == A_FUNCTION)
+    {
+        return;
+    }
+    if (n->type == A_SEQ)
+    {
+        for (int i = 0; i < AST_VALUE(n).list->count; i++)
+        {
+            reachCalls(AST_NODE(AST_VALUE(n).list->item[i]));
+        }
+        return;
+    }
+    if (n->type == A_CALL)
+    {
+        reach(AST_VALUE(n).symbol);
+    }
+    reachCalls(AST_LEFT(n));
+    reachCalls(AST_MID(n));
+    reachCalls(AST_RIGHT(n));
+}
+
+/**
+ * Generates the functions reachable from the top level after the entry code, so it runs without
+ * jumping over them. The others are dropped.
+ *
+ * @param n Root of the AST
+ */
+static void genFuncs(ASTnode *n)
+{
+    collectDefs(n);
+    Reached = (char *)arena_alloc(&GenArena, NumDefs + 1);
+    for (int i = 0; i < NumDefs; i++)
+    {
+        Reached[i] = 0;
+    }
+
+    if (Program != NULL)
+    {
+        IRfunc *top = Program->funcs[0];
+
+        for (int b = 0; b < top->nblocks; b++)
+        {
+            for (IRinstr *in = top->blocks[b]->first; in != NULL; in = in->next)
+            {
+                if (in->op == IR_CALL)
+                {
+                    reach(in->sym);
+                }
+            }
+        }
+    }
+    else
+    {
+        reachCalls(n);
+    }
+
+    for (int i = 0; i < NumDefs; i++)
+    {
+        Symbol *sym = AST_VALUE(Defs[i]).symbol;
+        IRfunc *f = Program != NULL ? ir_callee(Program, sym) : NULL;
+
+        if (!Reached[i])
+        {
+            if (OptReport)
+            {
+                fprintf(stderr, "dropped unreachable function %s\n", sym->name);
+            }
+            Stats.dropped++;
+        }
+        else if (f != NULL)
+        {
+            CG->freeall_registers();
+            ir_lower(f);
+        }
+        else
+        {
+            genFunction(Defs[i]);
+        }
+    }
+}
+
+/**
+ * Code generation through the IR for the top level, the functions follow in genFuncs().
+ *
+ * @param n Root of the AST
+ * @return NO_REG
+ */
+static int genIR(ASTnode *n)
+{
+    Program = ir_build(n);
+    ir_optimize(Program);
+    ir_lower(Program->funcs[0]);
+    return NO_REG;
+}
+
 /**
  * Driver function.
  */
@@ -438,7 +988,24 @@ void gencode(ASTnode *n)
     Symbol *glob = CurrentScope->head;
     ASTnode *tree = n;
 
+    // Text form of the IR instead of assembly
+    if (EmitIR)
+    {
+        IRprogram *p = ir_build(tree);
+
+        ir_optimize(p);
+        for (int i = 0; i < p->nfuncs; i++)
+        {
+            ir_dump(p->funcs[i], OutFile);
+        }
+        arena_free(&IrArena);
+        return;
+    }
+
     CG->data_seg(genGlobs, glob);
     CG->freeall_registers();
-    CG->text_seg(genAST, tree);
+    CG->text_seg(OptLevel > 0 ? genIR : genAST, tree);
+    genFuncs(tree);
+    CG->end();
+    arena_free(&IrArena);
 }
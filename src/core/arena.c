@@ -0,0 +1,155 @@
+/********************************************************************************
+ * File Name: src/core/arena.c                                                  *
+ *                                                                              *
+ * Description: Arena Allocator, hands out memory by bumping a pointer through  *
+ *              large blocks. Every compiler phase owns an arena and releases   *
+ *              all of its objects at once when the phase is over.              *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ ********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+#define ARENA_BLOCK 65536 // Default size of an arena block
+#define ARENA_ALIGN 16    // Alignment of every allocation
+
+/**
+ * Rounds a size up to the arena alignment.
+ *
+ * @param size The size
+ * @return The aligned size
+ */
+static size_t align(size_t size)
+{
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+/**
+ * Chains a new block to an arena, big requests get a block of their own size.
+ *
+ * @param a The arena
+ * @param size Bytes that must fit in the new block
+ */
+static void new_block(Arena *a, size_t size)
+{
+    size_t header = align(sizeof(ArenaBlock));
+    size_t capacity = size > ARENA_BLOCK ? size : ARENA_BLOCK;
+    ArenaBlock *b = (ArenaBlock *)malloc(header + capacity);
+
+    if (b == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+
+    b->prev = a->block;
+    b->ptr = (char *)b + header;
+    b->end = b->ptr + capacity;
+    a->block = b;
+    a->reserved += header + capacity;
+    if (a->reserved > a->peak)
+    {
+        a->peak = a->reserved;
+    }
+}
+
+/**
+ * Allocates memory from an arena, it stays valid until the arena is released.
+ *
+ * @param a The arena
+ * @param size Bytes requested
+ * @return The allocated memory
+ */
+void *arena_alloc(Arena *a, size_t size)
+{
+    void *p;
+
+    size = align(size);
+    if (a->block == NULL || (size_t)(a->block->end - a->block->ptr) < size)
+    {
+        new_block(a, size);
+    }
+
+    p = a->block->ptr;
+    a->block->ptr += size;
+    a->last = p;
+    a->objects++;
+    a->used += size;
+    return p;
+}
+
+/**
+ * Resizes an allocation. The last allocation of the arena grows in place when its block has
+ * room, any other one is copied to a new allocation.
+ *
+ * @param a The arena
+ * @param p The allocation, or NULL
+ * @param old Its current size
+ * @param size The new size
+ * @return The resized allocation
+ */
+void *arena_grow(Arena *a, void *p, size_t old, size_t size)
+{
+    void *q;
+
+    old = align(old);
+    size = align(size);
+    if (p != NULL && p == a->last && (size_t)(a->block->end - (char *)p) >= size)
+    {
+        a->block->ptr = (char *)p + size;
+        a->used += size - old;
+        return p;
+    }
+
+    q = arena_alloc(a, size);
+    if (p != NULL)
+    {
+        memcpy(q, p, old);
+        a->objects--; // Still the same object
+    }
+    return q;
+}
+
+/**
+ * Releases every block of an arena, the statistics are kept for the memory report.
+ *
+ * @param a The arena
+ */
+void arena_free(Arena *a)
+{
+    while (a->block != NULL)
+    {
+        ArenaBlock *prev = a->block->prev;
+
+        free(a->block);
+        a->block = prev;
+    }
+    a->last = NULL;
+    a->reserved = 0;
+}
+
+/**
+ * Prints the memory used by every arena.
+ */
+void mem_report(void)
+{
+    Arena *arenas[] = {&TokenArena, &AstArena, &SymArena, &GenArena, &IrArena};
+    size_t objects = 0, used = 0, peak = 0;
+
+    fprintf(stderr, "%-8s %10s %12s %12s\n", "arena", "objects", "bytes", "peak");
+    for (int i = 0; i < (int)(sizeof(arenas) / sizeof(arenas[0])); i++)
+    {
+        fprintf(stderr, "%-8s %10zu %12zu %12zu\n", arenas[i]->name, arenas[i]->objects, arenas[i]->used, arenas[i]->peak);
+        objects += arenas[i]->objects;
+        used += arenas[i]->used;
+        peak += arenas[i]->peak;
+    }
+    fprintf(stderr, "%-8s %10zu %12zu %12zu\n", "total", objects, used, peak);
+}
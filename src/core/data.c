@@ -13,22 +13,41 @@
 #undef extern_
 
 // Scanner state
-int Putback = 0;
 int Line = 1;
 int Column = 1;
-int Length = 0;
 
 // Parser state
 Symbol *CurrentFunction = NULL;
 Control *CurrentControl = NULL;
 
+// Abstract Syntax Tree
+ASTchunk **ASTchunks = NULL;
+
 // Scope manager
 Scope *CurrentScope = NULL;
 int LocalOffset = 0;
 
+// Input buffer
+char *InputStart = NULL;
+char *InputPtr = NULL;
+char *InputEnd = NULL;
+
+// Memory
+Arena TokenArena = {"tokens"};
+Arena AstArena = {"ast"};
+Arena SymArena = {"symbols"};
+Arena GenArena = {"codegen"};
+Arena IrArena = {"ir"};
+int MemReport = 0;
+
 // Code generation
 extern struct Backend ARM64_Backend;
 struct Backend *CG = &ARM64_Backend;
+int OptLevel = 0;
+int EmitIR = 0;
+int OptReport = 0;
+int InlineThreshold = 30;
+OptStats Stats;
 
 // File handles
 char *InputFilename = NULL;
@@ -0,0 +1,153 @@
+/********************************************************************************
+ * File Name: src/core/input.c                                                  *
+ *                                                                              *
+ * Description: Source Input Management, maps the whole input file into memory  *
+ *              so the scanner can walk it with a plain pointer. Falls back to  *
+ *              reading into a heap buffer for pipes and other special files.   *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ ********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+#define READ_CHUNK 65536 // Initial size of the fallback read buffer
+
+static size_t MappedSize = 0; // Size of the mapping, 0 if the buffer is on the heap
+
+/**
+ * Reads the whole content of a descriptor into a heap buffer.
+ *
+ * @param fd The file descriptor to read from
+ * @param size Where to store the number of bytes read
+ * @return The allocated buffer
+ */
+static char *read_all(int fd, size_t *size)
+{
+    size_t cap = READ_CHUNK, len = 0;
+    char *buf = (char *)malloc(cap);
+
+    if (buf == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+
+    for (;;)
+    {
+        ssize_t n;
+
+        if (len == cap)
+        {
+            cap *= 2;
+            if ((buf = (char *)realloc(buf, cap)) == NULL)
+            {
+                fprintf(stderr, "Fatal Error: out of memory\n");
+                exit(1);
+            }
+        }
+
+        n = read(fd, buf + len, cap - len);
+        if (n == 0)
+        {
+            break;
+        }
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            fprintf(stderr, "Error: cannot read input file '%s': %s\n", InputFilename, strerror(errno));
+            exit(1);
+        }
+        len += n;
+    }
+    *size = len;
+    return buf;
+}
+
+/**
+ * Opens the input file and makes its whole content available to the scanner.
+ *
+ * @param filename Path of the input file
+ */
+void open_input(char *filename)
+{
+    struct stat st;
+    size_t size;
+    int fd;
+
+    // A single dash reads the program from stdin
+    if (strcmp(filename, "-") == 0)
+    {
+        fd = dup(STDIN_FILENO);
+    }
+    else
+    {
+        fd = open(filename, O_RDONLY);
+    }
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error: cannot open input file '%s': %s\n", filename, strerror(errno));
+        exit(1);
+    }
+
+    // Regular files are mapped, everything else is read
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (map != MAP_FAILED)
+        {
+            MappedSize = st.st_size;
+            InputStart = (char *)map;
+            size = st.st_size;
+        }
+        else
+        {
+            InputStart = read_all(fd, &size);
+        }
+    }
+    else
+    {
+        InputStart = read_all(fd, &size);
+    }
+    close(fd);
+
+    InputPtr = InputStart;
+    InputEnd = InputStart + size;
+}
+
+/**
+ * Releases the input buffer.
+ */
+void close_input(void)
+{
+    if (InputStart == NULL)
+    {
+        return;
+    }
+
+    if (MappedSize > 0)
+    {
+        munmap(InputStart, MappedSize);
+    }
+    else
+    {
+        free(InputStart);
+    }
+    InputStart = InputPtr = InputEnd = NULL;
+    MappedSize = 0;
+}
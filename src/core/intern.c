@@ -0,0 +1,150 @@
+/********************************************************************************
+ * File Name: src/core/intern.c                                                 *
+ *                                                                              *
+ * Description: Name Interning, keeps a single copy of every identifier seen    *
+ *              in the input and gives each distinct name a small integer id.   *
+ *              Interned strings are unique, so they compare by pointer.        *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ ********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+#define INITIAL_SLOTS 1024 // Initial size of the hash index (power of two)
+
+static char **Names = NULL;     // Interned strings indexed by id
+static unsigned *Hashes = NULL; // Hash of every interned string
+static int NumNames = 0;        // Number of interned strings
+static int MaxNames = 0;        // Capacity of Names/Hashes
+
+static int *Slots = NULL; // Open addressing index, holds id + 1 (0 = empty)
+static int NumSlots = 0;  // Size of the index
+
+/**
+ * Hashes a string of known length (FNV-1a), the lexer computes the same hash while scanning.
+ *
+ * @param s The string
+ * @param len Its length
+ * @return The hash value
+ */
+unsigned strhash(char *s, int len)
+{
+    unsigned h = HASH_INIT;
+
+    for (int i = 0; i < len; i++)
+    {
+        h = HASH_STEP(h, s[i]);
+    }
+    return h;
+}
+
+/**
+ * Copies a name into the symbol arena, names live as long as the symbols using them.
+ *
+ * @param s The name (does not need to be NUL terminated)
+ * @param len Length of the name
+ * @return The NUL terminated copy
+ */
+static char *store(char *s, int len)
+{
+    char *copy = (char *)arena_alloc(&SymArena, len + 1);
+
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+/**
+ * Rebuilds the hash index with twice the slots.
+ */
+static void grow_index(void)
+{
+    int size = NumSlots ? NumSlots * 2 : INITIAL_SLOTS;
+    int *slots = (int *)calloc(size, sizeof(int));
+
+    if (slots == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+
+    for (int id = 0; id < NumNames; id++)
+    {
+        unsigned i = Hashes[id] & (size - 1);
+
+        while (slots[i] != 0)
+        {
+            i = (i + 1) & (size - 1);
+        }
+        slots[i] = id + 1;
+    }
+    free(Slots);
+    Slots = slots;
+    NumSlots = size;
+}
+
+/**
+ * Returns the id of a name, adding it to the table the first time it is seen.
+ *
+ * @param s The name (does not need to be NUL terminated)
+ * @param len Length of the name
+ * @param h Hash of the name, see strhash()
+ * @return The interned id
+ */
+int intern(char *s, int len, unsigned h)
+{
+    unsigned i;
+
+    // Keep the load factor under 1/2
+    if (2 * (NumNames + 1) > NumSlots)
+    {
+        grow_index();
+    }
+
+    i = h & (NumSlots - 1);
+    while (Slots[i] != 0)
+    {
+        int id = Slots[i] - 1;
+
+        if (Hashes[id] == h && strncmp(Names[id], s, len) == 0 && Names[id][len] == '\0')
+        {
+            return id;
+        }
+        i = (i + 1) & (NumSlots - 1);
+    }
+
+    if (NumNames == MaxNames)
+    {
+        MaxNames = MaxNames ? MaxNames * 2 : INITIAL_SLOTS / 2;
+        Names = (char **)realloc(Names, MaxNames * sizeof(char *));
+        Hashes = (unsigned *)realloc(Hashes, MaxNames * sizeof(unsigned));
+        if (Names == NULL || Hashes == NULL)
+        {
+            fprintf(stderr, "Fatal Error: out of memory\n");
+            exit(1);
+        }
+    }
+
+    Names[NumNames] = store(s, len);
+    Hashes[NumNames] = h;
+    Slots[i] = NumNames + 1;
+    return NumNames++;
+}
+
+/**
+ * Returns the string of an interned name, the same pointer for every occurrence of the name.
+ *
+ * @param id The interned id
+ * @return The interned string
+ */
+char *name_of(int id)
+{
+    return Names[id];
+}
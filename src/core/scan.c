@@ -1,8 +1,8 @@
 /********************************************************************************
  * File Name: src/core/scan.c                                                   *
  *                                                                              *
- * Description: Lexical Analyzer, converts the input character stream into a    *
- *              stream of Tokens.                                               *
+ * Description: Lexical Analyzer, converts the input buffer into a flat token   *
+ *              stream that the parser then walks by index.                     *
  * Author: Alejandro Diez Bermejo                                               *
  * Date: 2026-01-01                                                             *
  * Version: 0.0.0                                                               *
@@ -17,6 +17,11 @@
 #include "data.h"
 #include "decl.h"
 
+// Scanner position
+static int ScanLine = 1;   // Line of the scanning position
+static int ScanColumn = 1; // Column of the scanning position
+static int Length = 0;     // Length of the token being scanned
+
 /**
  * Finds the position of a character in a string.
  *
@@ -33,46 +38,32 @@ static int chrpos(char *s, int c)
 }
 
 /**
- * Puts a character back into the input stream buffer.
+ * Puts a character back into the input buffer.
  *
  * @param c The character to put back
- * @return The previous putback character
  */
-static int putback(int c)
+static void putback(int c)
 {
-    int old = Putback;
-
-    Putback = c;
-    if (c == 0)
-    {
-        Length = 0;
-    }
-    else
+    if (c != EOF)
     {
-        Length--;
+        InputPtr--;
     }
-    return old;
+    Length--;
 }
 
 /**
- * Gets the next character from the input stream.
+ * Gets the next character from the input buffer.
  *
  * @return The next character or EOF.
  */
 static int next(void)
 {
-    int c;
-
-    if (Putback)
-    {
-        c = putback(0);
-    }
-    else
+    Length++;
+    if (InputPtr < InputEnd)
     {
-        c = fgetc(InputFile);
+        return (unsigned char)*InputPtr++;
     }
-    Length++;
-    return c;
+    return EOF;
 }
 
 /**
@@ -82,28 +73,52 @@ static int next(void)
  */
 static int skip(void)
 {
-    int c = next();
+    char *p = InputPtr;
+    char *lastnl = NULL;
 
-    while (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '#')
+    for (;;)
     {
-        if (c == '#')
+        char *start = p;
+
+        // Jump over blanks, counting the newlines in bulk
+        p = skip_blanks(p, InputEnd, &ScanLine, &lastnl);
+        if (lastnl == NULL)
         {
-            // Skip comment until end of line
-            while ((c = next()) != EOF && c != '\n')
-            {
-            }
+            ScanColumn += p - start;
         }
 
-        if (c == '\n')
+        if (p == InputEnd || *p != '#')
         {
-            Line++;
-            Column = 0;
+            break;
         }
-        Column++;
-        Length = 0;
-        c = next();
+
+        // Skip comment until end of line
+        start = p;
+        p = find_newline(p, InputEnd);
+        if (p == InputEnd)
+        {
+            // The comment counts as one column when it ends the input
+            if (lastnl == NULL)
+            {
+                ScanColumn++;
+            }
+            else
+            {
+                ScanColumn = start - lastnl + 1;
+                lastnl = NULL;
+            }
+            break;
+        }
+    }
+
+    if (lastnl != NULL)
+    {
+        ScanColumn = p - lastnl;
     }
-    return c;
+
+    InputPtr = p;
+    Length = 0;
+    return next();
 }
 
 /**
@@ -126,151 +141,183 @@ static int scanint(int c)
 }
 
 /**
- * Scans an identifier or keyword.
+ * Scans an identifier or keyword in place, hashing its bytes on the way.
  *
  * @param c The first character
- * @param buf Buffer to store the string
- * @param lim Buffer size limit
+ * @param h Where to store the hash of the identifier
  * @return Length of the identifier
  */
-static int scanident(int c, char *buf, int lim)
+static int scanident(int c, unsigned *h)
 {
-    int i = 0;
+    unsigned hash = HASH_INIT;
+    int len = 0;
 
     while (isalpha(c) || isdigit(c) || c == '_')
     {
-        if (i < lim - 1)
+        if (++len >= MAX_LEN)
         {
-            buf[i++] = c;
-        }
-        else
-        {
-            fprintf(stderr, "Error: identifier too long at %d:%d\n", Line, Column);
+            fprintf(stderr, "Error: identifier too long at %d:%d\n", ScanLine, ScanColumn);
             exit(1);
         }
+        hash = HASH_STEP(hash, c);
         c = next();
     }
     putback(c);
-    buf[i] = '\0';
-    return i;
+    *h = hash;
+    return len;
 }
 
+// Keyword perfect hash, one slot per keyword
+static unsigned char KwDisp[NUM_KEYWORDS]; // Displacement of each first level bucket
+static unsigned char KwType[NUM_KEYWORDS]; // Keyword stored in each slot
+static unsigned KwHash[NUM_KEYWORDS];      // Hash of the keyword stored in each slot
+static unsigned char KwLen[NUM_KEYWORDS];  // Length of the keyword stored in each slot
+static int KwReady = 0;                    // Whether the tables have been generated
+
 /**
- * Checks if an identifier is a reserved keyword.
+ * Second level hash, places a keyword given its bucket displacement.
  *
- * @param s The identifier string
- * @return The TokenType (keyword or T_IDENT)
+ * @param h Hash of the identifier
+ * @param d Displacement of its bucket
+ * @return The slot index
+ */
+static int kwslot(unsigned h, unsigned d)
+{
+    return (((h >> 16) | (h << 16)) ^ (d * 0x9E3779B9u)) % NUM_KEYWORDS;
+}
+
+/**
+ * Generates a minimal perfect hash over the keywords in TokenTypeStr (hash and displace),
+ * every keyword gets its own slot and the table has no empty entries.
  */
-static int keyword(char *s)
+void init_keywords(void)
 {
-    switch (*s)
+    int bucketSize[NUM_KEYWORDS] = {0};
+    int used[NUM_KEYWORDS] = {0};
+    int done[NUM_KEYWORDS] = {0};
+
+    if (KwReady)
     {
-    case 'b':
-        if (!strcmp(s, "bool"))
-        {
-            return T_BOOL;
-        }
-        break;
-    case 'c':
-        if (!strcmp(s, "const"))
-        {
-            return T_CONST;
-        }
-        break;
-    case 'e':
-        if (!strcmp(s, "else"))
-        {
-            return T_ELSE;
-        }
-        break;
-    case 'f':
-        if (!strcmp(s, "false"))
-        {
-            return T_FALSE;
-        }
-        if (!strcmp(s, "fun"))
-        {
-            return T_FUN;
-        }
-        break;
-    case 'i':
-        if (!strcmp(s, "if"))
-        {
-            return T_IF;
-        }
-        if (!strcmp(s, "int"))
-        {
-            return T_INT;
-        }
-        break;
-    case 'l':
-        if (!strcmp(s, "loop"))
-        {
-            return T_LOOP;
-        }
-        break;
-    case 'm':
-        if (!strcmp(s, "match"))
-        {
-            return T_MATCH;
-        }
-        break;
-    case 'n':
-        if (!strcmp(s, "next"))
-        {
-            return T_NEXT;
-        }
-        break;
-    case 'p':
-        if (!strcmp(s, "print"))
-        {
-            return T_PRINT;
-        }
-        break;
-    case 'r':
-        if (!strcmp(s, "return"))
-        {
-            return T_RETURN;
-        }
-        break;
-    case 's':
-        if (!strcmp(s, "stop"))
-        {
-            return T_STOP;
-        }
-        break;
-    case 't':
-        if (!strcmp(s, "true"))
+        return;
+    }
+
+    for (int t = FIRST_KEYWORD; t <= LAST_KEYWORD; t++)
+    {
+        unsigned h = strhash((char *)TokenTypeStr[t], strlen(TokenTypeStr[t]));
+
+        bucketSize[h % NUM_KEYWORDS]++;
+    }
+
+    // Place the biggest buckets first
+    for (int n = 0; n < NUM_KEYWORDS; n++)
+    {
+        int b = -1;
+
+        for (int i = 0; i < NUM_KEYWORDS; i++)
         {
-            return T_TRUE;
+            if (!done[i] && (b < 0 || bucketSize[i] > bucketSize[b]))
+            {
+                b = i;
+            }
         }
-        break;
-    case 'v':
-        if (!strcmp(s, "var"))
+        done[b] = 1;
+        if (bucketSize[b] == 0)
         {
-            return T_VAR;
+            break;
         }
-        if (!strcmp(s, "void"))
+
+        // Find a displacement that sends every keyword of the bucket to a free slot
+        for (unsigned d = 0;; d++)
         {
-            return T_VOID;
+            int slots[NUM_KEYWORDS], k = 0, ok = 1;
+
+            if (d > 255)
+            {
+                fprintf(stderr, "Internal Error: cannot build keyword hash table\n");
+                exit(1);
+            }
+
+            for (int t = FIRST_KEYWORD; t <= LAST_KEYWORD && ok; t++)
+            {
+                unsigned h = strhash((char *)TokenTypeStr[t], strlen(TokenTypeStr[t]));
+                int slot = kwslot(h, d);
+
+                if (h % NUM_KEYWORDS != (unsigned)b)
+                {
+                    continue;
+                }
+                if (used[slot])
+                {
+                    ok = 0;
+                }
+                for (int i = 0; i < k; i++)
+                {
+                    if (slots[i] == slot)
+                    {
+                        ok = 0;
+                    }
+                }
+                slots[k++] = slot;
+            }
+            if (!ok)
+            {
+                continue;
+            }
+
+            KwDisp[b] = d;
+            for (int t = FIRST_KEYWORD; t <= LAST_KEYWORD; t++)
+            {
+                unsigned h = strhash((char *)TokenTypeStr[t], strlen(TokenTypeStr[t]));
+
+                if (h % NUM_KEYWORDS == (unsigned)b)
+                {
+                    int slot = kwslot(h, d);
+
+                    used[slot] = 1;
+                    KwType[slot] = t;
+                    KwHash[slot] = h;
+                    KwLen[slot] = strlen(TokenTypeStr[t]);
+                }
+            }
+            break;
         }
-        break;
+    }
+    KwReady = 1;
+}
+
+/**
+ * Checks if an identifier is a reserved keyword, needs a single string compare at most.
+ *
+ * @param s The identifier (not NUL terminated)
+ * @param len Length of the identifier
+ * @param h Hash of the identifier
+ * @return The TokenType (keyword or T_IDENT)
+ */
+int keyword(char *s, int len, unsigned h)
+{
+    int slot = kwslot(h, KwDisp[h % NUM_KEYWORDS]);
+
+    if (KwHash[slot] == h && KwLen[slot] == len && memcmp(TokenTypeStr[KwType[slot]], s, len) == 0)
+    {
+        return KwType[slot];
     }
     return T_IDENT;
 }
 
 /**
- * Main scanning function.
+ * Scans the next token from the input buffer.
  *
- * @param t Pointer to the Token structure to fill
+ * @param t Pointer to the Token structure to fill, identifiers carry their interned id
  * @return 1 if token found, 0 if EOF
  */
-int scan(Token *t)
+static int lex(Token *t)
 {
     int c;
 
+    t->value.integer = 0;
+
     // Advance column by the length of the previous token
-    Column += Length;
+    ScanColumn += Length;
     Length = 0;
 
     c = skip();
@@ -427,7 +474,7 @@ int scan(Token *t)
         }
         else
         {
-            fprintf(stderr, "Syntax Error: unknown token '&' at %d:%d\n", Line, Column);
+            fprintf(stderr, "Syntax Error: unknown token '&' at %d:%d\n", ScanLine, ScanColumn);
             exit(1);
         }
         break;
@@ -446,7 +493,7 @@ int scan(Token *t)
         }
         else
         {
-            fprintf(stderr, "Syntax Error: unknown token '|' at %d:%d\n", Line, Column);
+            fprintf(stderr, "Syntax Error: unknown token '|' at %d:%d\n", ScanLine, ScanColumn);
             exit(1);
         }
         break;
@@ -459,31 +506,19 @@ int scan(Token *t)
         }
         else if (isalpha(c) || c == '_')
         {
-            char buffer[MAX_LEN];
+            char *start = InputPtr - 1;
+            unsigned h;
+            int len = scanident(c, &h);
 
-            scanident(c, buffer, MAX_LEN);
-            if (strcmp(buffer, "_") == 0)
-            {
-                t->type = T_UNDERSCORE;
-            }
-            else
+            t->type = keyword(start, len, h);
+            if (t->type == T_IDENT)
             {
-                int type = keyword(buffer);
-
-                t->type = type;
-                if (type == T_IDENT)
-                {
-                    t->value.string = strdup(buffer);
-                }
-                else
-                {
-                    t->value.string = NULL;
-                }
+                t->value.integer = intern(start, len, h);
             }
         }
         else
         {
-            fprintf(stderr, "Syntax Error: unknown character '%c' at %d:%d\n", c, Line, Column);
+            fprintf(stderr, "Syntax Error: unknown character '%c' at %d:%d\n", c, ScanLine, ScanColumn);
             exit(1);
         }
         break;
@@ -491,6 +526,86 @@ int scan(Token *t)
     return 1;
 }
 
+/**
+ * Appends a token to the token stream, growing the arrays in the token arena when needed.
+ *
+ * @param t The scanned token
+ * @param offset Offset of the token in the input buffer
+ */
+static void append(Token *t, int offset)
+{
+    TokenStream *ts = &Tokens;
+
+    if (ts->count == ts->capacity)
+    {
+        int old = ts->capacity;
+
+        ts->capacity = old ? old * 2 : 1024;
+        ts->type = (unsigned char *)arena_grow(&TokenArena, ts->type, old * sizeof(unsigned char), ts->capacity * sizeof(unsigned char));
+        ts->offset = (int *)arena_grow(&TokenArena, ts->offset, old * sizeof(int), ts->capacity * sizeof(int));
+        ts->line = (int *)arena_grow(&TokenArena, ts->line, old * sizeof(int), ts->capacity * sizeof(int));
+        ts->column = (int *)arena_grow(&TokenArena, ts->column, old * sizeof(int), ts->capacity * sizeof(int));
+        ts->value = (int *)arena_grow(&TokenArena, ts->value, old * sizeof(int), ts->capacity * sizeof(int));
+    }
+
+    ts->type[ts->count] = t->type;
+    ts->offset[ts->count] = offset;
+    ts->line[ts->count] = ScanLine;
+    ts->column[ts->count] = ScanColumn;
+    ts->value[ts->count] = t->value.integer;
+    ts->count++;
+}
+
+/**
+ * Scans the whole input buffer into the token stream, the stream always ends with T_EOF.
+ */
+void tokenize(void)
+{
+    Token t;
+
+    init_keywords();
+
+    do
+    {
+        lex(&t);
+        append(&t, t.type == T_EOF ? (int)(InputEnd - InputStart) : (int)(InputPtr - InputStart) - Length);
+    } while (t.type != T_EOF);
+
+    TokenPos = -1;
+}
+
+/**
+ * Releases the token stream.
+ */
+void free_tokens(void)
+{
+    arena_free(&TokenArena);
+    Tokens = (TokenStream){0};
+}
+
+/**
+ * Moves to the next token of the stream and decodes it into CurrentToken.
+ */
+void advance(void)
+{
+    if (TokenPos < Tokens.count - 1)
+    {
+        TokenPos++;
+    }
+
+    CurrentToken.type = Tokens.type[TokenPos];
+    if (CurrentToken.type == T_IDENT)
+    {
+        CurrentToken.value.string = name_of(Tokens.value[TokenPos]);
+    }
+    else
+    {
+        CurrentToken.value.integer = Tokens.value[TokenPos];
+    }
+    Line = Tokens.line[TokenPos];
+    Column = Tokens.column[TokenPos];
+}
+
 /**
  * Verifies the current token matches the expected type, advances the scanner if it matches.
  *
@@ -500,7 +615,7 @@ void match(TokenType t)
 {
     if (CurrentToken.type == t)
     {
-        scan(&CurrentToken);
+        advance();
     }
     else
     {
@@ -511,26 +626,18 @@ void match(TokenType t)
 }
 
 /**
- * Looks ahead at the next token without consuming it.
+ * Looks ahead at the k-th token after the current one without consuming it.
  *
- * @return The TokenType of the next token.
+ * @param k Lookahead distance (1 is the token right after CurrentToken)
+ * @return The TokenType of that token.
  */
-TokenType peek(void)
+TokenType peek(int k)
 {
-    Token tmpToken;
-    long pos = ftell(InputFile);
-    int oldPutback = Putback;
-    int oldLine = Line;
-    int oldCol = Column;
-    int oldLen = Length;
-
-    scan(&tmpToken);
-
-    fseek(InputFile, pos, SEEK_SET);
-    Putback = oldPutback;
-    Line = oldLine;
-    Column = oldCol;
-    Length = oldLen;
-
-    return tmpToken.type;
+    int pos = TokenPos + k;
+
+    if (pos >= Tokens.count)
+    {
+        pos = Tokens.count - 1;
+    }
+    return Tokens.type[pos];
 }
@@ -0,0 +1,227 @@
+/********************************************************************************
+ * File Name: src/core/simd.c                                                   *
+ *                                                                              *
+ * Description: Vectorized byte scanning for the lexer, skips blanks and finds  *
+ *              line ends 16/32 bytes at a time using SSE2/AVX2 on x86-64 and   *
+ *              NEON on AArch64, with a scalar fallback for everything else.    *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ ********************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+// Every vector variant defines:
+//   BLOCK        Bytes compared per step
+//   STRIDE       Mask bits produced per byte
+//   mask_t       Integer type holding one bit group per byte
+//   blank_mask() Mask of whitespace bytes, also returns the newline mask
+//   byte_mask()  Mask of the bytes equal to a given value
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+#define BLOCK 32
+#define STRIDE 1
+typedef uint32_t mask_t;
+
+static mask_t byte_mask(const char *p, char c)
+{
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+
+    return (mask_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+}
+
+static mask_t blank_mask(const char *p, mask_t *nl)
+{
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i n = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+    __m256i b = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+
+    b = _mm256_or_si256(b, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+    b = _mm256_or_si256(b, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\f')));
+    *nl = (mask_t)_mm256_movemask_epi8(n);
+    return (mask_t)_mm256_movemask_epi8(_mm256_or_si256(b, n));
+}
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+
+#define BLOCK 16
+#define STRIDE 1
+typedef uint32_t mask_t;
+
+static mask_t byte_mask(const char *p, char c)
+{
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+
+    return (mask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+static mask_t blank_mask(const char *p, mask_t *nl)
+{
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i n = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+    __m128i b = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+
+    b = _mm_or_si128(b, _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+    b = _mm_or_si128(b, _mm_cmpeq_epi8(v, _mm_set1_epi8('\f')));
+    *nl = (mask_t)_mm_movemask_epi8(n);
+    return (mask_t)_mm_movemask_epi8(_mm_or_si128(b, n));
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+
+// NEON has no movemask, narrowing each 0x00/0xFF byte to a nibble gives a 64-bit mask
+#define BLOCK 16
+#define STRIDE 4
+typedef uint64_t mask_t;
+
+static mask_t to_mask(uint8x16_t cmp)
+{
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4)), 0);
+}
+
+static mask_t byte_mask(const char *p, char c)
+{
+    uint8x16_t v = vld1q_u8((const uint8_t *)p);
+
+    return to_mask(vceqq_u8(v, vdupq_n_u8((uint8_t)c)));
+}
+
+static mask_t blank_mask(const char *p, mask_t *nl)
+{
+    uint8x16_t v = vld1q_u8((const uint8_t *)p);
+    uint8x16_t n = vceqq_u8(v, vdupq_n_u8('\n'));
+    uint8x16_t b = vorrq_u8(vceqq_u8(v, vdupq_n_u8(' ')), vceqq_u8(v, vdupq_n_u8('\t')));
+
+    b = vorrq_u8(b, vceqq_u8(v, vdupq_n_u8('\r')));
+    b = vorrq_u8(b, vceqq_u8(v, vdupq_n_u8('\f')));
+    *nl = to_mask(n);
+    return to_mask(vorrq_u8(b, n));
+}
+#endif
+
+#ifdef BLOCK
+#define ALL_BLANK ((mask_t)~(mask_t)0 >> (8 * sizeof(mask_t) - BLOCK * STRIDE))
+
+/**
+ * Index of the lowest byte flagged in a mask.
+ *
+ * @param m A non-zero mask
+ * @return The byte index
+ */
+static int first_byte(mask_t m)
+{
+    return (sizeof(mask_t) == 8 ? __builtin_ctzll(m) : __builtin_ctz(m)) / STRIDE;
+}
+
+/**
+ * Index of the highest byte flagged in a mask.
+ *
+ * @param m A non-zero mask
+ * @return The byte index
+ */
+static int last_byte(mask_t m)
+{
+    int bits = 8 * sizeof(mask_t);
+
+    return (bits - 1 - (sizeof(mask_t) == 8 ? __builtin_clzll(m) : __builtin_clz(m))) / STRIDE;
+}
+
+/**
+ * Number of bytes flagged in a mask.
+ *
+ * @param m The mask
+ * @return The byte count
+ */
+static int count_bytes(mask_t m)
+{
+    return (sizeof(mask_t) == 8 ? __builtin_popcountll(m) : __builtin_popcount(m)) / STRIDE;
+}
+#endif
+
+/**
+ * Skips spaces, tabs, carriage returns, form feeds and newlines.
+ *
+ * @param p Where to start
+ * @param end End of the buffer
+ * @param lines Incremented by the number of newlines skipped
+ * @param lastnl Set to the last newline skipped, left untouched if none
+ * @return The first byte that is not blank, or end
+ */
+char *skip_blanks(char *p, char *end, int *lines, char **lastnl)
+{
+#ifdef BLOCK
+    while (end - p >= BLOCK)
+    {
+        mask_t nl;
+        mask_t stop = ~blank_mask(p, &nl) & ALL_BLANK;
+
+        if (stop != 0)
+        {
+            int first = first_byte(stop);
+
+            // Only newlines before the first significant byte count
+            nl &= ((mask_t)1 << (first * STRIDE)) - 1;
+            if (nl != 0)
+            {
+                *lines += count_bytes(nl);
+                *lastnl = p + last_byte(nl);
+            }
+            return p + first;
+        }
+
+        if (nl != 0)
+        {
+            *lines += count_bytes(nl);
+            *lastnl = p + last_byte(nl);
+        }
+        p += BLOCK;
+    }
+#endif
+
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '\f'))
+    {
+        if (*p == '\n')
+        {
+            (*lines)++;
+            *lastnl = p;
+        }
+        p++;
+    }
+    return p;
+}
+
+/**
+ * Finds the next newline, used to jump over comments.
+ *
+ * @param p Where to start
+ * @param end End of the buffer
+ * @return The newline, or end if there is none
+ */
+char *find_newline(char *p, char *end)
+{
+#ifdef BLOCK
+    while (end - p >= BLOCK)
+    {
+        mask_t nl = byte_mask(p, '\n');
+
+        if (nl != 0)
+        {
+            return p + first_byte(nl);
+        }
+        p += BLOCK;
+    }
+#endif
+
+    p = memchr(p, '\n', end - p);
+    return p ? p : end;
+}
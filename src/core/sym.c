@@ -11,37 +11,127 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "defs.h"
 #include "data.h"
 #include "decl.h"
 
+#define INITIAL_BINDINGS 256 // Initial size of the binding index (power of two)
+
+// Binding index, maps every interned name to its innermost visible symbol
+typedef struct Binding
+{
+    char *name;  // Interned name, NULL if the slot is empty
+    Symbol *sym; // Innermost symbol with that name, NULL if none is visible
+} Binding;
+
+static Binding *Bindings = NULL; // Open addressing table keyed by name pointer
+static int NumBindings = 0;      // Used slots
+static int MaxBindings = 0;      // Size of the table
+
 /**
- * Allocates and initializes a new Symbol structure.
+ * Hashes an interned name by its address.
  *
- * @param name Symbol name
- * @param stype Symbol type
- * @param ptype Primary type
- * @return The created symbol
+ * @param name Interned name
+ * @return The hash value
  */
-static Symbol *newsym(char *name, SType stype, PType ptype)
+static unsigned ptrhash(char *name)
 {
-    Symbol *sym = (Symbol *)malloc(sizeof(Symbol));
+    uintptr_t p = (uintptr_t)name;
+
+    return (unsigned)((p >> 4) ^ (p >> 20)) * 2654435761u;
+}
 
-    if (sym == NULL)
+/**
+ * Rebuilds the binding index with twice the slots.
+ */
+static void grow_bindings(void)
+{
+    int size = MaxBindings ? MaxBindings * 2 : INITIAL_BINDINGS;
+    Binding *table = (Binding *)calloc(size, sizeof(Binding));
+
+    if (table == NULL)
     {
         fprintf(stderr, "Fatal Error: out of memory\n");
         exit(1);
     }
 
-    sym->name = strdup(name);
+    for (int i = 0; i < MaxBindings; i++)
+    {
+        if (Bindings[i].name != NULL)
+        {
+            unsigned j = ptrhash(Bindings[i].name) & (size - 1);
+
+            while (table[j].name != NULL)
+            {
+                j = (j + 1) & (size - 1);
+            }
+            table[j] = Bindings[i];
+        }
+    }
+    free(Bindings);
+    Bindings = table;
+    MaxBindings = size;
+}
+
+/**
+ * Finds the binding slot of a name, claiming an empty one the first time the name is seen.
+ *
+ * @param name Interned name
+ * @return The binding slot
+ */
+static Binding *binding(char *name)
+{
+    unsigned i;
+
+    // Keep the load factor under 1/2
+    if (2 * (NumBindings + 1) > MaxBindings)
+    {
+        grow_bindings();
+    }
+
+    i = ptrhash(name) & (MaxBindings - 1);
+    while (Bindings[i].name != NULL)
+    {
+        if (Bindings[i].name == name)
+        {
+            return &Bindings[i];
+        }
+        i = (i + 1) & (MaxBindings - 1);
+    }
+
+    Bindings[i].name = name;
+    Bindings[i].sym = NULL;
+    NumBindings++;
+    return &Bindings[i];
+}
+
+/**
+ * Allocates and initializes a new Symbol structure.
+ *
+ * @param name Symbol name (interned)
+ * @param stype Symbol type
+ * @param ptype Primary type
+ * @return The created symbol
+ */
+static Symbol *newsym(char *name, SType stype, PType ptype)
+{
+    Symbol *sym = (Symbol *)arena_alloc(&SymArena, sizeof(Symbol));
+
+    sym->name = name;
     sym->stype = stype;
     sym->ptype = ptype;
     sym->size = 0;
     sym->offset = 0;
+    sym->value = 0;
     sym->numParams = 0;
     sym->params = NULL;
+    sym->inlining = INL_AUTO;
+    sym->level = 0;
+    sym->function = NULL;
+    sym->shadowed = NULL;
     sym->next = NULL;
     return sym;
 }
@@ -54,13 +144,7 @@ static Symbol *newsym(char *name, SType stype, PType ptype)
  */
 static Scope *newscope(Scope *parent)
 {
-    Scope *s = (Scope *)malloc(sizeof(Scope));
-
-    if (s == NULL)
-    {
-        fprintf(stderr, "Fatal Error: out of memory\n");
-        exit(1);
-    }
+    Scope *s = (Scope *)arena_alloc(&SymArena, sizeof(Scope));
 
     s->head = NULL;
     s->tail = NULL;
@@ -86,7 +170,7 @@ void scope_enter(void)
 }
 
 /**
- * Pops the current scope from the stack.
+ * Pops the current scope from the stack, its symbols stop hiding the ones they shadowed.
  */
 void scope_exit(void)
 {
@@ -95,6 +179,11 @@ void scope_exit(void)
         fprintf(stderr, "Compiler Error: syntax indicates exiting global scope\n");
         exit(1);
     }
+
+    for (Symbol *sym = CurrentScope->head; sym != NULL; sym = sym->next)
+    {
+        binding(sym->name)->sym = sym->shadowed;
+    }
     CurrentScope = CurrentScope->parent;
 }
 
@@ -111,55 +200,35 @@ int is_global_scope(void)
 /**
  * Looks for a symbol ONLY in the active scope.
  *
- * @param name Symbol name
+ * @param name Symbol name (interned, compared by pointer)
  * @return The symbol if it was found, otherwise NULL
  */
 Symbol *find_in_current_scope(char *name)
 {
-    Symbol *sym = CurrentScope->head;
+    Symbol *sym = findsymbol(name);
 
-    while (sym != NULL)
+    if (sym != NULL && sym->level == CurrentScope->level)
     {
-        if (strcmp(name, sym->name) == 0)
-        {
-            return sym;
-        }
-        sym = sym->next;
+        return sym;
     }
     return NULL;
 }
 
 /**
- * Looks for a symbol walking UP the scope stack.
+ * Looks for a symbol walking UP the scope stack, the binding index already holds the innermost one.
  *
- * @param name Symbol name
+ * @param name Symbol name (interned, compared by pointer)
  * @return The symbol if it was found, otherwise NULL
  */
 Symbol *findsymbol(char *name)
 {
-    Scope *scope = CurrentScope;
-
-    while (scope != NULL)
-    {
-        Symbol *sym = scope->head;
-
-        while (sym != NULL)
-        {
-            if (strcmp(name, sym->name) == 0)
-            {
-                return sym;
-            }
-            sym = sym->next;
-        }
-        scope = scope->parent;
-    }
-    return NULL;
+    return binding(name)->sym;
 }
 
 /**
  * Adds a new symbol to the CURRENT scope.
  *
- * @param name Symbol name
+ * @param name Symbol name (interned)
  * @param stype Symbol type
  * @param ptype Primary type
  * @return The created symbol
@@ -216,6 +285,14 @@ Symbol *addsymbol(char *name, SType stype, PType ptype)
         sym->offset = 0;
     }
 
+    // Bind the name, hiding any outer symbol with the same name
+    Binding *b = binding(name);
+
+    sym->level = CurrentScope->level;
+    sym->function = CurrentFunction;
+    sym->shadowed = b->sym;
+    b->sym = sym;
+
     if (CurrentScope->head == NULL)
     {
         CurrentScope->head = CurrentScope->tail = sym;
@@ -226,4 +303,24 @@ Symbol *addsymbol(char *name, SType stype, PType ptype)
         CurrentScope->tail = CurrentScope->tail->next;
     }
     return sym;
-}
\ No newline at end of file
+}
+
+/**
+ * Checks if a function is declared inside another one, at any depth. Such a function may read
+ * the locals in the frame of the other.
+ *
+ * @param fn The function
+ * @param outer The function that may hold it
+ * @return 1 if fn is nested in outer
+ */
+int is_nested_in(Symbol *fn, Symbol *outer)
+{
+    for (Symbol *f = fn->function; f != NULL; f = f->function)
+    {
+        if (f == outer)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,1139 @@
+/********************************************************************************
+ * File Name: src/ir/build.c                                                    *
+ *                                                                              *
+ * Description: IR Builder, translates the AST of every function into SSA form  *
+ *              while walking it once (Braun et al.). Locals and parameters     *
+ *              become values, globals stay loads and stores.                   *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ ********************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+#define INITIAL_DEFS 1024 // Initial size of the definition table (power of two)
+
+// Targets of 'next' and 'stop', one entry per enclosing loop or match
+typedef struct Flow
+{
+    IRblock *next;     // Continue target, NULL for a match
+    IRblock *stop;     // Break target
+    struct Flow *prev; // Enclosing entry
+} Flow;
+
+// Current definition of a variable in a block
+typedef struct Def
+{
+    IRblock *block; // Block, NULL if the slot is empty
+    Symbol *sym;    // Variable
+    int value;      // Value number
+} Def;
+
+static IRprogram *Program; // Program being built
+static IRfunc *Func;       // Function being built
+static IRblock *Block;     // Block receiving the instructions
+static Flow *Flows;        // Innermost loop or match
+
+static Def *Defs = NULL; // Open addressing table keyed by block and variable
+static int NumDefs = 0;  // Used slots
+static int MaxDefs = 0;  // Size of the table
+
+/**
+ * Hashes a block and variable pair.
+ *
+ * @param b The block
+ * @param sym The variable
+ * @return The hash value
+ */
+static unsigned defhash(IRblock *b, Symbol *sym)
+{
+    uintptr_t h = ((uintptr_t)sym >> 4) * 0x9E3779B1u + (uintptr_t)b->id * 0x85EBCA6Bu;
+
+    return (unsigned)(h ^ (h >> 15));
+}
+
+/**
+ * Rebuilds the definition table with twice the slots.
+ */
+static void grow_defs(void)
+{
+    int size = MaxDefs ? MaxDefs * 2 : INITIAL_DEFS;
+    Def *table = (Def *)calloc(size, sizeof(Def));
+
+    if (table == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+
+    for (int i = 0; i < MaxDefs; i++)
+    {
+        if (Defs[i].block != NULL)
+        {
+            unsigned j = defhash(Defs[i].block, Defs[i].sym) & (size - 1);
+
+            while (table[j].block != NULL)
+            {
+                j = (j + 1) & (size - 1);
+            }
+            table[j] = Defs[i];
+        }
+    }
+    free(Defs);
+    Defs = table;
+    MaxDefs = size;
+}
+
+/**
+ * Finds the slot of a variable in a block.
+ *
+ * @param b The block
+ * @param sym The variable
+ * @return The slot, empty if the block does not define the variable
+ */
+static Def *find_def(IRblock *b, Symbol *sym)
+{
+    unsigned i = defhash(b, sym) & (MaxDefs - 1);
+
+    while (Defs[i].block != NULL && (Defs[i].block != b || Defs[i].sym != sym))
+    {
+        i = (i + 1) & (MaxDefs - 1);
+    }
+    return &Defs[i];
+}
+
+/**
+ * Records the value a variable holds at the end of a block (so far).
+ *
+ * @param sym The variable
+ * @param b The block
+ * @param v Value number
+ */
+static void write_variable(Symbol *sym, IRblock *b, int v)
+{
+    Def *d;
+
+    // Keep the load factor under 1/2
+    if (2 * (NumDefs + 1) > MaxDefs)
+    {
+        grow_defs();
+    }
+    d = find_def(b, sym);
+    if (d->block == NULL)
+    {
+        d->block = b;
+        d->sym = sym;
+        NumDefs++;
+    }
+    d->value = v;
+}
+
+/**
+ * Creates an empty phi at the start of a block.
+ *
+ * @param b The block
+ * @param sym Variable it merges
+ * @return The phi
+ */
+static IRinstr *new_phi(IRblock *b, Symbol *sym)
+{
+    IRinstr *phi = ir_instr(Func, IR_PHI, 0);
+    IRinstr *pos = b->first;
+
+    phi->sym = sym;
+    while (pos != NULL && pos->op == IR_PHI)
+    {
+        pos = pos->next;
+    }
+    if (pos != NULL)
+    {
+        ir_insert_before(pos, phi);
+    }
+    else
+    {
+        ir_append(b, phi);
+    }
+    return phi;
+}
+
+/**
+ * Replaces a phi by its only argument when it does not merge different values.
+ *
+ * @param phi The phi
+ * @return The value standing for the phi
+ */
+static int try_remove_trivial_phi(IRinstr *phi)
+{
+    int same = -1;
+
+    for (int i = 0; i < phi->nargs; i++)
+    {
+        int v = ir_resolve(Func, phi->args[i]);
+
+        if (v == same || v == phi->id)
+        {
+            continue;
+        }
+        if (same != -1)
+        {
+            return phi->id;
+        }
+        same = v;
+    }
+    if (same == -1)
+    {
+        same = ir_undef(Func);
+    }
+    ir_replace(Func, phi->id, same);
+    ir_remove(Func, phi);
+    return same;
+}
+
+static int read_variable(Symbol *sym, IRblock *b);
+
+/**
+ * Fills a phi with the value of its variable in every predecessor.
+ *
+ * @param sym The variable
+ * @param phi The phi
+ * @return The value standing for the phi
+ */
+static int add_phi_operands(Symbol *sym, IRinstr *phi)
+{
+    IRblock *b = phi->block;
+
+    for (int i = 0; i < b->npreds; i++)
+    {
+        ir_add_arg(phi, read_variable(sym, b->preds[i]));
+    }
+    return try_remove_trivial_phi(phi);
+}
+
+/**
+ * Looks for the value of a variable in the predecessors of a block.
+ *
+ * @param sym The variable
+ * @param b The block
+ * @return Value number
+ */
+static int read_variable_recursive(Symbol *sym, IRblock *b)
+{
+    int v;
+
+    if (!b->sealed)
+    {
+        // Filled when the block is sealed
+        v = new_phi(b, sym)->id;
+    }
+    else if (b->npreds == 0)
+    {
+        v = ir_undef(Func);
+    }
+    else if (b->npreds == 1)
+    {
+        v = read_variable(sym, b->preds[0]);
+    }
+    else
+    {
+        IRinstr *phi = new_phi(b, sym);
+
+        // Break cycles through loops
+        write_variable(sym, b, phi->id);
+        v = add_phi_operands(sym, phi);
+    }
+    write_variable(sym, b, v);
+    return v;
+}
+
+/**
+ * Returns the value of a variable at the end of a block (so far).
+ *
+ * @param sym The variable
+ * @param b The block
+ * @return Value number
+ */
+static int read_variable(Symbol *sym, IRblock *b)
+{
+    Def *d;
+
+    if (MaxDefs == 0)
+    {
+        grow_defs();
+    }
+    d = find_def(b, sym);
+    if (d->block != NULL)
+    {
+        return ir_resolve(Func, d->value);
+    }
+    return read_variable_recursive(sym, b);
+}
+
+/**
+ * Marks a block as having all its predecessors, the phis created meanwhile get their arguments.
+ *
+ * @param b The block
+ */
+static void seal_block(IRblock *b)
+{
+    IRinstr *in = b->first;
+
+    b->sealed = 1;
+    while (in != NULL && in->op == IR_PHI)
+    {
+        IRinstr *next = in->next;
+
+        if (in->nargs == 0)
+        {
+            add_phi_operands(in->sym, in);
+        }
+        in = next;
+    }
+}
+
+/**
+ * Creates a block with no predecessors to hold the code following a jump, it is dropped
+ * once the function is built.
+ *
+ * @return The block
+ */
+static IRblock *dead_block(void)
+{
+    IRblock *b = ir_block(Func);
+
+    b->sealed = 1;
+    return b;
+}
+
+/**
+ * Checks if a symbol is a variable in SSA form in the function being built.
+ *
+ * @param sym The symbol
+ * @return 1 for the locals and parameters of the function
+ */
+static int is_ssa(Symbol *sym)
+{
+    return (sym->sclass == C_LOCAL || sym->sclass == C_PARAM) && sym->function == Func->sym;
+}
+
+/**
+ * Appends a new instruction to the current block.
+ *
+ * @param op The operation
+ * @param nargs Number of arguments
+ * @return The instruction
+ */
+static IRinstr *emit(IRop op, int nargs)
+{
+    IRinstr *in = ir_instr(Func, op, nargs);
+
+    ir_append(Block, in);
+    return in;
+}
+
+/**
+ * Emits a constant.
+ *
+ * @param val The constant
+ * @return Value number
+ */
+static int constant(int val)
+{
+    IRinstr *in = emit(IR_CONST, 0);
+
+    in->imm = val;
+    return in->id;
+}
+
+/**
+ * Emits a one argument operation.
+ *
+ * @param op The operation
+ * @param a Argument
+ * @return Value number
+ */
+static int unary(IRop op, int a)
+{
+    IRinstr *in = emit(op, 1);
+
+    in->args[0] = a;
+    return in->id;
+}
+
+/**
+ * Emits a two argument operation.
+ *
+ * @param op The operation
+ * @param a Left argument
+ * @param b Right argument
+ * @return Value number
+ */
+static int binary(IRop op, int a, int b)
+{
+    IRinstr *in = emit(op, 2);
+
+    in->args[0] = a;
+    in->args[1] = b;
+    return in->id;
+}
+
+/**
+ * Ends the current block with a jump.
+ *
+ * @param to Destination block
+ */
+static void jump(IRblock *to)
+{
+    emit(IR_JMP, 0);
+    ir_edge(Block, to);
+}
+
+/**
+ * Ends the current block with a conditional branch.
+ *
+ * @param v The condition
+ * @param t Destination when it is true
+ * @param f Destination when it is false
+ */
+static void branch(int v, IRblock *t, IRblock *f)
+{
+    unary(IR_BR, v);
+    ir_edge(Block, t);
+    ir_edge(Block, f);
+}
+
+/**
+ * Assigns a value to a variable, ints keep only their low 32 bits like in memory.
+ *
+ * @param sym The variable
+ * @param v Value number
+ */
+static void write(Symbol *sym, int v)
+{
+    if (!is_ssa(sym))
+    {
+        IRinstr *in = emit(IR_STORE, 1);
+
+        in->sym = sym;
+        in->args[0] = v;
+        return;
+    }
+    if (sym->ptype == P_INT && !ir_is_narrow(Func, v))
+    {
+        v = unary(IR_SEXT, v);
+    }
+    write_variable(sym, Block, v);
+}
+
+/**
+ * Reads a variable.
+ *
+ * @param sym The variable
+ * @return Value number
+ */
+static int read(Symbol *sym)
+{
+    IRinstr *in;
+
+    if (is_ssa(sym))
+    {
+        return read_variable(sym, Block);
+    }
+    in = emit(IR_LOAD, 0);
+    in->sym = sym;
+    return in->id;
+}
+
+/**
+ * Creates a variable that only lives in SSA form, used to merge values of expressions.
+ *
+ * @param ptype Type of the variable
+ * @return The variable
+ */
+static Symbol *temporary(PType ptype)
+{
+    Symbol *sym = (Symbol *)arena_alloc(&IrArena, sizeof(Symbol));
+
+    memset(sym, 0, sizeof(Symbol));
+    sym->name = "tmp";
+    sym->stype = S_VARIABLE;
+    sym->ptype = ptype;
+    sym->sclass = C_LOCAL;
+    sym->function = Func->sym;
+    return sym;
+}
+
+static int gen_expr(ASTnode *n);
+
+/**
+ * Translates a condition in branch context, && and || become jumps.
+ *
+ * @param n The boolean expression
+ * @param t Destination when it is true
+ * @param f Destination when it is false
+ */
+static void gen_cond(ASTnode *n, IRblock *t, IRblock *f)
+{
+    switch (n->type)
+    {
+    case A_TRUE:
+        jump(t);
+        return;
+    case A_FALSE:
+        jump(f);
+        return;
+    case A_NOT:
+        gen_cond(AST_LEFT(n), f, t);
+        return;
+    case A_AND:
+    case A_OR:
+    {
+        IRblock *right = ir_block(Func);
+
+        if (n->type == A_AND)
+        {
+            gen_cond(AST_LEFT(n), right, f);
+        }
+        else
+        {
+            gen_cond(AST_LEFT(n), t, right);
+        }
+        seal_block(right);
+        Block = right;
+        gen_cond(AST_RIGHT(n), t, f);
+        return;
+    }
+    default:
+        branch(gen_expr(n), t, f);
+        return;
+    }
+}
+
+/**
+ * Translates && and || as values, the right side only runs when the left one does not
+ * decide the result.
+ *
+ * @param left Value of the left side
+ * @param right The right side
+ * @param isAnd 1 for &&, 0 for ||
+ * @param sym Variable assigned the right side (&&=, ||=), or NULL
+ * @return Value number of the result
+ */
+static int gen_short_circuit(int left, ASTnode *right, int isAnd, Symbol *sym)
+{
+    Symbol *tmp = temporary(P_BOOL);
+    IRblock *rhs = ir_block(Func);
+    IRblock *end = ir_block(Func);
+    int v;
+
+    write_variable(tmp, Block, left);
+    if (isAnd)
+    {
+        branch(left, rhs, end);
+    }
+    else
+    {
+        branch(left, end, rhs);
+    }
+    seal_block(rhs);
+    Block = rhs;
+    v = gen_expr(right);
+    write_variable(tmp, Block, v);
+    if (sym != NULL)
+    {
+        write(sym, v);
+    }
+    jump(end);
+    seal_block(end);
+    Block = end;
+    return read_variable(tmp, Block);
+}
+
+/**
+ * Translates an assignment.
+ *
+ * @param n The assignment node
+ * @return Value number of the assigned value
+ */
+static int gen_assign(ASTnode *n)
+{
+    Symbol *sym = AST_VALUE(AST_LEFT(n)).symbol;
+    IRop op;
+    int v;
+
+    switch (n->type)
+    {
+    case A_ASSIGN:
+        v = gen_expr(AST_RIGHT(n));
+        write(sym, v);
+        return v;
+    case A_ASAND:
+    case A_ASOR:
+        return gen_short_circuit(read(sym), AST_RIGHT(n), n->type == A_ASAND, sym);
+    case A_ASADD:
+        op = IR_ADD;
+        break;
+    case A_ASSUB:
+        op = IR_SUB;
+        break;
+    case A_ASMUL:
+        op = IR_MUL;
+        break;
+    case A_ASDIV:
+        op = IR_DIV;
+        break;
+    case A_ASMOD:
+        op = IR_MOD;
+        break;
+    default:
+        op = IR_POW;
+        break;
+    }
+    v = read(sym);
+    v = binary(op, v, gen_expr(AST_RIGHT(n)));
+    write(sym, v);
+    return v;
+}
+
+/**
+ * Translates a function call.
+ *
+ * @param n The call node
+ * @return Value number of the result
+ */
+static int gen_call(ASTnode *n)
+{
+    ASTnode *arg;
+    int args[8], nargs = 0;
+    IRinstr *in;
+
+    for (arg = AST_LEFT(n); arg != NULL; arg = AST_RIGHT(arg))
+    {
+        int v = gen_expr(AST_LEFT(arg));
+
+        // Only eight arguments travel in registers
+        if (nargs < 8)
+        {
+            args[nargs++] = v;
+        }
+    }
+    in = emit(IR_CALL, nargs);
+    in->sym = AST_VALUE(n).symbol;
+    if (nargs > 0)
+    {
+        memcpy(in->args, args, nargs * sizeof(int));
+    }
+    return in->id;
+}
+
+/**
+ * Translates an expression.
+ *
+ * @param n The expression
+ * @return Value number of the result
+ */
+static int gen_expr(ASTnode *n)
+{
+    static const IRop binops[] = {
+        [A_ADD] = IR_ADD, [A_SUB] = IR_SUB, [A_MUL] = IR_MUL, [A_DIV] = IR_DIV, [A_MOD] = IR_MOD, [A_POW] = IR_POW,
+        [A_EQ] = IR_EQ, [A_NEQ] = IR_NE, [A_LT] = IR_LT, [A_LE] = IR_LE, [A_GT] = IR_GT, [A_GE] = IR_GE};
+
+    switch (n->type)
+    {
+    // Literals
+    case A_INTLIT:
+        return constant(AST_VALUE(n).integer);
+    case A_TRUE:
+        return constant(1);
+    case A_FALSE:
+        return constant(0);
+    // Identifiers
+    case A_IDENT:
+        return read(AST_VALUE(n).symbol);
+    // Unary operations
+    case A_POS:
+        return gen_expr(AST_LEFT(n));
+    case A_NEG:
+        return unary(IR_NEG, gen_expr(AST_LEFT(n)));
+    case A_NOT:
+        return unary(IR_NOT, gen_expr(AST_LEFT(n)));
+    // Binary operations
+    case A_ADD:
+    case A_SUB:
+    case A_MUL:
+    case A_DIV:
+    case A_MOD:
+    case A_POW:
+    case A_EQ:
+    case A_NEQ:
+    case A_LT:
+    case A_LE:
+    case A_GT:
+    case A_GE:
+    {
+        int left = gen_expr(AST_LEFT(n));
+
+        return binary(binops[n->type], left, gen_expr(AST_RIGHT(n)));
+    }
+    case A_AND:
+    case A_OR:
+        return gen_short_circuit(gen_expr(AST_LEFT(n)), AST_RIGHT(n), n->type == A_AND, NULL);
+    // Assignment
+    case A_ASSIGN:
+    case A_ASADD:
+    case A_ASSUB:
+    case A_ASMUL:
+    case A_ASDIV:
+    case A_ASMOD:
+    case A_ASPOW:
+    case A_ASAND:
+    case A_ASOR:
+        return gen_assign(n);
+    case A_CALL:
+        return gen_call(n);
+    default:
+        fprintf(stderr, "Fatal Error: unknown AST Node %d\n", n->type);
+        exit(1);
+    }
+}
+
+/**
+ * Looks for the target of 'next'.
+ *
+ * @return The block, or NULL outside loops
+ */
+static IRblock *next_target(void)
+{
+    for (Flow *f = Flows; f != NULL; f = f->prev)
+    {
+        if (f->next != NULL)
+        {
+            return f->next;
+        }
+    }
+    return NULL;
+}
+
+static void gen_stmt(ASTnode *n);
+
+/**
+ * Translates a match whose cases are constants into a switch on the scrutinee, evaluated once.
+ * After a body the match goes on with the next case of the same value, or the default, which is
+ * what testing the remaining cases would find.
+ *
+ * @param n The match node
+ * @param stop Block after the match
+ */
+static void gen_switch(ASTnode *n, IRblock *stop)
+{
+    ASTnode *c;
+    IRblock **bodies, **targets, *deflt = stop;
+    IRinstr *in;
+    int count = 0, nvals = 0, i = 0, v;
+    int *vals;
+
+    for (c = AST_RIGHT(n); c != NULL; c = AST_RIGHT(c))
+    {
+        count++;
+    }
+    bodies = (IRblock **)malloc((count + 1) * sizeof(IRblock *));
+    targets = (IRblock **)malloc((count + 1) * sizeof(IRblock *));
+    vals = (int *)malloc((count + 1) * sizeof(int));
+    if (bodies == NULL || targets == NULL || vals == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+
+    // The first case of every value takes the edge, the default comes last
+    for (c = AST_RIGHT(n); c != NULL; c = AST_RIGHT(c), i++)
+    {
+        int j = 0;
+
+        bodies[i] = ir_block(Func);
+        if (AST_LEFT(c) == NULL)
+        {
+            deflt = bodies[i];
+            continue;
+        }
+        while (j < nvals && vals[j] != const_value(AST_LEFT(c)))
+        {
+            j++;
+        }
+        if (j == nvals)
+        {
+            vals[nvals] = const_value(AST_LEFT(c));
+            targets[nvals++] = bodies[i];
+        }
+    }
+    v = gen_expr(AST_LEFT(n));
+    for (int j = 0; j < nvals; j++)
+    {
+        vals[j] = constant(vals[j]);
+    }
+    in = emit(IR_SWITCH, nvals + 1);
+    in->args[0] = v;
+    for (int j = 0; j < nvals; j++)
+    {
+        in->args[j + 1] = vals[j];
+        ir_edge(Block, targets[j]);
+    }
+    ir_edge(Block, deflt);
+
+    // Every body is entered from the switch and the bodies before it
+    for (c = AST_RIGHT(n), i = 0; c != NULL; c = AST_RIGHT(c), i++)
+    {
+        IRblock *next = deflt == bodies[i] ? stop : deflt;
+        int k = i + 1;
+
+        for (ASTnode *d = AST_RIGHT(c); d != NULL && AST_LEFT(c) != NULL; d = AST_RIGHT(d), k++)
+        {
+            if (AST_LEFT(d) != NULL && const_value(AST_LEFT(d)) == const_value(AST_LEFT(c)))
+            {
+                next = bodies[k];
+                break;
+            }
+        }
+        seal_block(bodies[i]);
+        Block = bodies[i];
+        gen_stmt(AST_MID(c));
+        jump(next);
+    }
+    free(bodies);
+    free(targets);
+    free(vals);
+}
+
+/**
+ * Translates a match. Constant cases become a switch, the others are tested in order against
+ * the variable the parser stored the scrutinee in.
+ *
+ * @param n The match node
+ */
+static void gen_match(ASTnode *n)
+{
+    Flow flow = {NULL, ir_block(Func), Flows};
+
+    Flows = &flow;
+    if (literal_cases(n))
+    {
+        gen_switch(n, flow.stop);
+    }
+    else
+    {
+        // The scrutinee is evaluated once, every test reads the same value
+        int left = gen_expr(AST_LEFT(n));
+
+        for (ASTnode *c = AST_RIGHT(n); c != NULL; c = AST_RIGHT(c))
+        {
+            IRblock *next = ir_block(Func);
+
+            if (AST_LEFT(c))
+            {
+                IRblock *body = ir_block(Func);
+
+                branch(binary(IR_EQ, left, gen_expr(AST_LEFT(c))), body, next);
+                seal_block(body);
+                Block = body;
+            }
+            gen_stmt(AST_MID(c));
+            jump(next);
+            seal_block(next);
+            Block = next;
+        }
+        jump(flow.stop);
+    }
+    seal_block(flow.stop);
+    Block = flow.stop;
+    Flows = flow.prev;
+}
+
+/**
+ * Translates a loop rotated into a guard and a loop that tests the condition at the bottom, so
+ * every iteration takes a single branch back.
+ *
+ * @param n The loop node
+ */
+static void gen_loop(ASTnode *n)
+{
+    IRblock *body = ir_block(Func);
+    Flow flow;
+
+    flow.next = ir_block(Func);
+    flow.stop = ir_block(Func);
+    flow.prev = Flows;
+
+    // Guard, the loop may not run at all
+    gen_cond(AST_LEFT(n), body, flow.stop);
+
+    // Body, entered again from the bottom
+    Block = body;
+    Flows = &flow;
+    gen_stmt(AST_MID(n));
+    Flows = flow.prev;
+    jump(flow.next);
+
+    // Update and condition
+    seal_block(flow.next);
+    Block = flow.next;
+    gen_stmt(AST_RIGHT(n));
+    gen_cond(AST_LEFT(n), body, flow.stop);
+
+    seal_block(body);
+    seal_block(flow.stop);
+    Block = flow.stop;
+}
+
+/**
+ * Translates a statement.
+ *
+ * @param n The statement
+ */
+static void gen_stmt(ASTnode *n)
+{
+    if (n == NULL)
+    {
+        return;
+    }
+
+    switch (n->type)
+    {
+    case A_SEQ:
+        for (int i = 0; i < AST_VALUE(n).list->count; i++)
+        {
+            gen_stmt(AST_NODE(AST_VALUE(n).list->item[i]));
+        }
+        return;
+    case A_GLUE:
+        gen_stmt(AST_LEFT(n));
+        gen_stmt(AST_RIGHT(n));
+        return;
+    case A_IFELSE:
+    {
+        IRblock *then = ir_block(Func);
+        IRblock *end = ir_block(Func);
+        IRblock *other = n->right ? ir_block(Func) : end;
+
+        gen_cond(AST_LEFT(n), then, other);
+        seal_block(then);
+        Block = then;
+        gen_stmt(AST_MID(n));
+        jump(end);
+        if (AST_RIGHT(n))
+        {
+            seal_block(other);
+            Block = other;
+            gen_stmt(AST_RIGHT(n));
+            jump(end);
+        }
+        seal_block(end);
+        Block = end;
+        return;
+    }
+    case A_MATCH:
+        gen_match(n);
+        return;
+    case A_LOOP:
+        gen_loop(n);
+        return;
+    case A_STOP:
+        if (Flows == NULL)
+        {
+            fprintf(stderr, "Error: 'stop' outside loop/match\n");
+            exit(1);
+        }
+        jump(Flows->stop);
+        Block = dead_block();
+        return;
+    case A_NEXT:
+        if (next_target() == NULL)
+        {
+            fprintf(stderr, "Error: 'next' outside loop\n");
+            exit(1);
+        }
+        jump(next_target());
+        Block = dead_block();
+        return;
+    case A_RETURN:
+        if (AST_LEFT(n))
+        {
+            unary(IR_RET, gen_expr(AST_LEFT(n)));
+        }
+        else
+        {
+            emit(IR_RET, 0);
+        }
+        Block = dead_block();
+        return;
+    case A_PRINT:
+        unary(IR_PRINT, gen_expr(AST_LEFT(n)));
+        return;
+    case A_FUNCTION:
+        // Built on its own
+        return;
+    default:
+        gen_expr(n);
+        return;
+    }
+}
+
+/**
+ * Checks if the code of a function, leaving out nested functions, reads locals of another one.
+ * Those functions are left to the direct code generator.
+ *
+ * @param n Node of the body
+ * @param fn The function
+ * @return 1 if some local does not belong to the function
+ */
+static int uses_outer_locals(ASTnode *n, Symbol *fn)
+{
+    if (n == NULL || n->type == A_FUNCTION)
+    {
+        return 0;
+    }
+    if (n->type == A_SEQ)
+    {
+        for (int i = 0; i < AST_VALUE(n).list->count; i++)
+        {
+            if (uses_outer_locals(AST_NODE(AST_VALUE(n).list->item[i]), fn))
+            {
+                return 1;
+            }
+        }
+        return 0;
+    }
+    if (n->type == A_IDENT)
+    {
+        Symbol *sym = AST_VALUE(n).symbol;
+
+        return (sym->sclass == C_LOCAL || sym->sclass == C_PARAM) && sym->function != fn;
+    }
+    return uses_outer_locals(AST_LEFT(n), fn) || uses_outer_locals(AST_MID(n), fn) ||
+           uses_outer_locals(AST_RIGHT(n), fn);
+}
+
+/**
+ * Translates the body of a function.
+ *
+ * @param sym Function symbol, NULL for the top level
+ * @param body Its statements
+ * @return The function in SSA form
+ */
+static IRfunc *build_func(Symbol *sym, ASTnode *body)
+{
+    Symbol *param;
+    IRfunc *f = ir_func(sym);
+
+    Func = f;
+    Flows = NULL;
+    NumDefs = 0;
+    if (Defs != NULL)
+    {
+        memset(Defs, 0, MaxDefs * sizeof(Def));
+    }
+
+    Block = ir_block(f);
+    Block->sealed = 1;
+
+    // Parameters arrive in registers, ints keep their low 32 bits like in memory
+    param = sym != NULL ? sym->params : NULL;
+    for (int i = 0; sym != NULL && i < sym->numParams; i++, param = param->next)
+    {
+        IRinstr *in = emit(IR_PARAM, 0);
+
+        in->imm = i;
+        write(param, in->id);
+    }
+
+    gen_stmt(body);
+    emit(IR_RET, 0);
+
+    ir_cleanup(f);
+    ir_verify(f);
+    return f;
+}
+
+/**
+ * Adds a function to the program.
+ *
+ * @param f The function
+ */
+static void add_func(IRfunc *f)
+{
+    if (Program->nfuncs == Program->maxfuncs)
+    {
+        Program->maxfuncs = Program->maxfuncs ? Program->maxfuncs * 2 : 8;
+        Program->funcs = (IRfunc **)arena_grow(&IrArena, Program->funcs, Program->nfuncs * sizeof(IRfunc *),
+                                               Program->maxfuncs * sizeof(IRfunc *));
+    }
+    Program->funcs[Program->nfuncs++] = f;
+}
+
+/**
+ * Finds the functions declared in some code and builds them, nested ones included.
+ *
+ * @param n Node of the code
+ */
+static void collect(ASTnode *n)
+{
+    if (n == NULL)
+    {
+        return;
+    }
+    if (n->type == A_SEQ)
+    {
+        for (int i = 0; i < AST_VALUE(n).list->count; i++)
+        {
+            collect(AST_NODE(AST_VALUE(n).list->item[i]));
+        }
+        return;
+    }
+    if (n->type != A_FUNCTION)
+    {
+        collect(AST_LEFT(n));
+        collect(AST_MID(n));
+        collect(AST_RIGHT(n));
+        return;
+    }
+
+    // Left to the direct path along with its nested functions, genFuncs() emits all of them
+    if (uses_outer_locals(AST_LEFT(n), AST_VALUE(n).symbol))
+    {
+        if (Program->ndirect == Program->maxdirect)
+        {
+            Program->maxdirect = Program->maxdirect ? Program->maxdirect * 2 : 8;
+            Program->direct = (ASTnode **)arena_grow(&IrArena, Program->direct, Program->ndirect * sizeof(ASTnode *),
+                                                     Program->maxdirect * sizeof(ASTnode *));
+        }
+        Program->direct[Program->ndirect++] = n;
+        return;
+    }
+    add_func(build_func(AST_VALUE(n).symbol, AST_LEFT(n)));
+    collect(AST_LEFT(n));
+}
+
+/**
+ * Translates a whole program into SSA form.
+ *
+ * @param tree The AST of the program
+ * @return The program, the top level comes first
+ */
+IRprogram *ir_build(ASTnode *tree)
+{
+    Program = (IRprogram *)arena_alloc(&IrArena, sizeof(IRprogram));
+    memset(Program, 0, sizeof(IRprogram));
+
+    add_func(build_func(NULL, tree));
+    collect(tree);
+
+    free(Defs);
+    Defs = NULL;
+    MaxDefs = NumDefs = 0;
+    return Program;
+}
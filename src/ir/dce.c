@@ -0,0 +1,235 @@
+/********************************************************************************
+ * File Name: src/ir/dce.c                                                      *
+ *                                                                              *
+ * Description: Dead Code Elimination, removes the instructions whose values    *
+ *              never reach a store, a call, a print or a branch, and then      *
+ *              simplifies the CFG by merging straight-line blocks and          *
+ *              skipping the blocks that only jump.                             *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ ********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+/**
+ * Removes the instructions that nothing with an effect depends on. Starting from the effects
+ * also removes the cycles of phis that only feed each other.
+ *
+ * @param f The function
+ * @return 1 if any instruction was removed
+ */
+static int remove_dead_values(IRfunc *f)
+{
+    char *live = (char *)calloc(f->nvalues + 1, sizeof(char));
+    IRinstr **work = (IRinstr **)malloc((f->nvalues + 1) * sizeof(IRinstr *));
+    int n = 0, changed = 0;
+
+    if (live == NULL || work == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        for (IRinstr *in = f->blocks[i]->first; in != NULL; in = in->next)
+        {
+            if (ir_has_effects(in->op))
+            {
+                live[in->id] = 1;
+                work[n++] = in;
+            }
+        }
+    }
+    while (n > 0)
+    {
+        IRinstr *in = work[--n];
+
+        for (int a = 0; a < in->nargs; a++)
+        {
+            if (!live[in->args[a]])
+            {
+                live[in->args[a]] = 1;
+                work[n++] = f->values[in->args[a]];
+            }
+        }
+    }
+
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        IRinstr *in, *next;
+
+        for (in = f->blocks[i]->first; in != NULL; in = next)
+        {
+            next = in->next;
+            if (!live[in->id])
+            {
+                ir_remove(f, in);
+                changed = 1;
+            }
+        }
+    }
+    free(live);
+    free(work);
+    return changed;
+}
+
+/**
+ * Turns a branch whose two edges go to the same block into a jump.
+ *
+ * @param b The block
+ * @return 1 if the branch was replaced
+ */
+static int merge_branch(IRblock *b)
+{
+    IRblock *s = b->nsucc > 0 ? b->succ[0] : NULL;
+    int first = -1;
+
+    if (b->nsucc != 2 || s != b->succ[1])
+    {
+        return 0;
+    }
+    // Both edges must bring the same values to the phis
+    for (int p = 0; p < s->npreds; p++)
+    {
+        if (s->preds[p] != b)
+        {
+            continue;
+        }
+        if (first == -1)
+        {
+            first = p;
+            continue;
+        }
+        for (IRinstr *in = s->first; in != NULL && in->op == IR_PHI; in = in->next)
+        {
+            if (in->args[p] != in->args[first])
+            {
+                return 0;
+            }
+        }
+    }
+    ir_remove_edge(b, 1);
+    b->last->op = IR_JMP;
+    b->last->nargs = 0;
+    return 1;
+}
+
+/**
+ * Moves the instructions of the only successor of a block into it, when the block is its only
+ * predecessor.
+ *
+ * @param f The function
+ * @param b The block
+ * @return 1 if the blocks were merged
+ */
+static int merge_successor(IRfunc *f, IRblock *b)
+{
+    IRblock *s = b->nsucc > 0 ? b->succ[0] : NULL;
+    IRinstr *in;
+
+    if (b->nsucc != 1 || s->npreds != 1 || s == b || s == f->blocks[0])
+    {
+        return 0;
+    }
+
+    // The phis of a block with one predecessor are copies
+    while (s->first != NULL && s->first->op == IR_PHI)
+    {
+        ir_replace(f, s->first->id, s->first->args[0]);
+        ir_remove(f, s->first);
+    }
+    ir_remove(f, b->last);
+    while ((in = s->first) != NULL)
+    {
+        ir_remove(f, in);
+        f->values[in->id] = in;
+        ir_append(b, in);
+    }
+
+    // The successors of s now come from b, in the same slots
+    b->succ = s->succ;
+    b->nsucc = s->nsucc;
+    b->maxsucc = s->maxsucc;
+    for (int k = 0; k < s->nsucc; k++)
+    {
+        IRblock *t = s->succ[k];
+
+        for (int p = 0; p < t->npreds; p++)
+        {
+            if (t->preds[p] == s)
+            {
+                t->preds[p] = b;
+            }
+        }
+    }
+    s->succ = NULL;
+    s->nsucc = s->maxsucc = 0;
+    s->npreds = 0;
+    return 1;
+}
+
+/**
+ * Sends the predecessors of a block that only jumps straight to its destination.
+ *
+ * @param f The function
+ * @param b The block
+ * @return 1 if the block was skipped
+ */
+static int skip_jump(IRfunc *f, IRblock *b)
+{
+    IRblock *s = b->nsucc > 0 ? b->succ[0] : NULL;
+
+    if (b->first != b->last || b->nsucc != 1 || s == b || b == f->blocks[0] || s == f->blocks[0] ||
+        (s->first != NULL && s->first->op == IR_PHI))
+    {
+        return 0;
+    }
+    // Left without predecessors, the clean-up deletes it
+    while (b->npreds > 0)
+    {
+        IRblock *pred = b->preds[0];
+        int k = 0;
+
+        while (pred->succ[k] != b)
+        {
+            k++;
+        }
+        ir_retarget(pred, k, s);
+    }
+    return 1;
+}
+
+/**
+ * Removes the dead code of a function and the blocks left with nothing to do.
+ *
+ * @param f The function
+ */
+void ir_dce(IRfunc *f)
+{
+    int changed = 1;
+
+    while (changed)
+    {
+        changed = remove_dead_values(f);
+        for (int i = 0; i < f->nblocks; i++)
+        {
+            IRblock *b = f->blocks[i];
+
+            if (b->last == NULL)
+            {
+                continue; // Emptied by a merge
+            }
+            changed |= merge_branch(b);
+            changed |= merge_successor(f, b);
+            changed |= skip_jump(f, b);
+        }
+        ir_cleanup(f);
+    }
+}
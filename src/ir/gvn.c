@@ -0,0 +1,374 @@
+/********************************************************************************
+ * File Name: src/ir/gvn.c                                                      *
+ *                                                                              *
+ * Description: Global Value Numbering, walks the dominator tree with a scoped  *
+ *              table of the expressions already computed and replaces the      *
+ *              ones computed again. Loads of globals are reused until a call   *
+ *              may change them, and a store feeds the loads that follow it.    *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ ********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+// An expression already computed, its key is everything but value, widen and next
+typedef struct Expr
+{
+    IRop op;       // The operation, IR_LOAD for what a store left in memory
+    int imm;       // Constant
+    Symbol *sym;   // Global of a load
+    int epoch;     // Memory state a load belongs to
+    IRblock *phi;  // Block of a phi, they only match within one block
+    int nargs;     // Number of arguments
+    int arg[2];    // Arguments, in order for the commutative operations
+    int *args;     // Arguments of a phi
+    unsigned hash; // Hash of the key
+    int value;     // Value number holding the result
+    int widen;     // A store of an int that still has to be sign extended
+    int next;      // Older entry in the same bucket
+} Expr;
+
+// Frame of the walk over the dominator tree
+typedef struct Visit
+{
+    IRblock *block; // The block
+    int mark;       // Entries in the table before the block
+    int epoch;      // Memory state at the end of the block
+    int child;      // Next child to walk
+} Visit;
+
+static IRfunc *Func;   // Function being numbered
+static Expr *Exprs;    // Entries of the table, newest last
+static int NumExprs;   // Entries in use
+static int *Buckets;   // Newest entry of every bucket, -1 if empty
+static unsigned Mask;  // Number of buckets minus one
+static int Epoch;      // Current memory state
+static int NumEpochs;  // Memory states handed out
+
+/**
+ * Allocates memory or stops the compiler.
+ *
+ * @param n Number of entries
+ * @param size Size of an entry
+ * @return The memory
+ */
+static void *xmalloc(int n, size_t size)
+{
+    void *p = malloc((n + 1) * size);
+
+    if (p == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+/**
+ * Checks if the order of the arguments of an operation does not matter.
+ *
+ * @param op The operation
+ * @return 1 if it is commutative
+ */
+static int commutative(IRop op)
+{
+    return op == IR_ADD || op == IR_MUL || op == IR_EQ || op == IR_NE;
+}
+
+/**
+ * Fills the key of an instruction.
+ *
+ * @param in The instruction, its arguments already resolved
+ * @param e The key
+ */
+static void make_key(IRinstr *in, Expr *e)
+{
+    unsigned h;
+
+    e->op = in->op;
+    e->imm = in->op == IR_CONST ? in->imm : 0;
+    e->sym = in->op == IR_LOAD ? in->sym : NULL;
+    e->epoch = in->op == IR_LOAD ? Epoch : 0;
+    e->phi = in->op == IR_PHI ? in->block : NULL;
+    e->nargs = in->op == IR_LOAD ? 0 : in->nargs;
+    e->args = in->op == IR_PHI ? in->args : NULL;
+    e->arg[0] = e->arg[1] = 0;
+    for (int a = 0; a < e->nargs && in->op != IR_PHI; a++)
+    {
+        e->arg[a] = in->args[a];
+    }
+    if (commutative(in->op) && e->arg[0] > e->arg[1])
+    {
+        e->arg[0] = in->args[1];
+        e->arg[1] = in->args[0];
+    }
+
+    h = (unsigned)e->op * 31u + (unsigned)e->imm;
+    h = h * 31u + (unsigned)((uintptr_t)e->sym >> 4);
+    h = h * 31u + (unsigned)e->epoch;
+    h = h * 31u + (unsigned)((uintptr_t)e->phi >> 4);
+    h = h * 31u + (unsigned)e->arg[0];
+    h = h * 31u + (unsigned)e->arg[1];
+    for (int a = 0; e->args != NULL && a < e->nargs; a++)
+    {
+        h = h * 31u + (unsigned)e->args[a];
+    }
+    e->hash = h;
+}
+
+/**
+ * Compares two keys.
+ *
+ * @param a First key
+ * @param b Second key
+ * @return 1 if they compute the same value
+ */
+static int same_key(Expr *a, Expr *b)
+{
+    if (a->hash != b->hash || a->op != b->op || a->imm != b->imm || a->sym != b->sym || a->epoch != b->epoch ||
+        a->phi != b->phi || a->nargs != b->nargs || a->arg[0] != b->arg[0] || a->arg[1] != b->arg[1])
+    {
+        return 0;
+    }
+    for (int i = 0; a->args != NULL && i < a->nargs; i++)
+    {
+        if (a->args[i] != b->args[i])
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Looks for an expression in the table.
+ *
+ * @param key The key
+ * @return The newest matching entry, NULL if there is none
+ */
+static Expr *lookup(Expr *key)
+{
+    for (int i = Buckets[key->hash & Mask]; i != -1; i = Exprs[i].next)
+    {
+        if (same_key(&Exprs[i], key))
+        {
+            return &Exprs[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Adds an expression to the table, it hides any older one with the same key.
+ *
+ * @param key The key
+ * @param value Value number of its result
+ * @param widen 1 if the value still has to be sign extended
+ */
+static void insert(Expr *key, int value, int widen)
+{
+    Expr *e = &Exprs[NumExprs];
+
+    *e = *key;
+    e->value = value;
+    e->widen = widen;
+    e->next = Buckets[e->hash & Mask];
+    Buckets[e->hash & Mask] = NumExprs++;
+}
+
+/**
+ * Drops the entries added after a mark, in the opposite order they were added.
+ *
+ * @param mark Number of entries to keep
+ */
+static void restore(int mark)
+{
+    while (NumExprs > mark)
+    {
+        Expr *e = &Exprs[--NumExprs];
+
+        Buckets[e->hash & Mask] = e->next;
+    }
+}
+
+/**
+ * Replaces an instruction with a value computed before.
+ *
+ * @param in The instruction
+ * @param value The value
+ */
+static void reuse(IRinstr *in, int value)
+{
+    ir_replace(Func, in->id, value);
+    ir_remove(Func, in);
+}
+
+/**
+ * Numbers the instructions of a block.
+ *
+ * @param b The block
+ */
+static void number_block(IRblock *b)
+{
+    IRinstr *in, *next;
+    Expr key;
+
+    for (in = b->first; in != NULL; in = next)
+    {
+        Expr *e;
+
+        next = in->next;
+        for (int a = 0; a < in->nargs; a++)
+        {
+            in->args[a] = ir_resolve(Func, in->args[a]);
+        }
+
+        switch (in->op)
+        {
+        case IR_CALL:
+            // Any global may change
+            Epoch = ++NumEpochs;
+            continue;
+        case IR_STORE:
+            // What a load reads next, memory keeps the low 32 bits of an int
+            in->op = IR_LOAD;
+            make_key(in, &key);
+            in->op = IR_STORE;
+            insert(&key, in->args[0], in->sym->ptype == P_INT && !ir_is_narrow(Func, in->args[0]));
+            continue;
+        case IR_LOAD:
+            make_key(in, &key);
+            e = lookup(&key);
+            if (e == NULL)
+            {
+                insert(&key, in->id, 0);
+                continue;
+            }
+            Stats.loads++;
+            if (!e->widen)
+            {
+                reuse(in, e->value);
+                continue;
+            }
+            // The load becomes the extension of the stored value, numbered below
+            in->op = IR_SEXT;
+            in->sym = NULL;
+            ir_add_arg(in, e->value);
+            insert(&key, in->id, 0);
+            break;
+        case IR_PARAM:
+        case IR_PRINT:
+        case IR_JMP:
+        case IR_BR:
+        case IR_SWITCH:
+        case IR_RET:
+            continue;
+        default:
+            break;
+        }
+
+        make_key(in, &key);
+        e = lookup(&key);
+        if (e != NULL)
+        {
+            Stats.redundant++;
+            reuse(in, e->value);
+            continue;
+        }
+        insert(&key, in->id, 0);
+    }
+}
+
+/**
+ * Removes the values computed twice in a function. An expression is known in the blocks its
+ * first computation dominates. A load is only known while no call can run in between, so it
+ * reaches the blocks whose only predecessor is their dominator.
+ *
+ * @param f The function
+ */
+void ir_gvn(IRfunc *f)
+{
+    int n = f->nblocks, sp = 0, buckets = 16;
+    int *first = (int *)xmalloc(n + 1, sizeof(int));
+    IRblock **children = (IRblock **)xmalloc(n, sizeof(IRblock *));
+    Visit *stack = (Visit *)xmalloc(n, sizeof(Visit));
+
+    Func = f;
+    ir_dominators(f);
+
+    // Children of every block in the dominator tree, in reverse postorder
+    for (int i = 0; i <= n; i++)
+    {
+        first[i] = 0;
+    }
+    for (int i = 1; i < f->norder; i++)
+    {
+        first[f->order[i]->idom->id + 1]++;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        first[i + 1] += first[i];
+    }
+    for (int i = 1; i < f->norder; i++)
+    {
+        children[first[f->order[i]->idom->id]++] = f->order[i];
+    }
+    for (int i = n; i > 0; i--)
+    {
+        first[i] = first[i - 1];
+    }
+    first[0] = 0;
+
+    // Every instruction adds at most two entries
+    while (buckets < f->nvalues * 2)
+    {
+        buckets *= 2;
+    }
+    Mask = buckets - 1;
+    Buckets = (int *)xmalloc(buckets, sizeof(int));
+    for (int i = 0; i < buckets; i++)
+    {
+        Buckets[i] = -1;
+    }
+    Exprs = (Expr *)xmalloc(f->nvalues * 2, sizeof(Expr));
+    NumExprs = 0;
+    NumEpochs = 0;
+
+    stack[sp++] = (Visit){f->order[0], 0, 0, first[f->order[0]->id]};
+    Epoch = 0;
+    number_block(f->order[0]);
+    stack[0].epoch = Epoch;
+    while (sp > 0)
+    {
+        Visit *s = &stack[sp - 1];
+        IRblock *c;
+
+        if (s->child == first[s->block->id + 1])
+        {
+            restore(s->mark);
+            sp--;
+            continue;
+        }
+        c = children[s->child++];
+
+        // Memory is only known along a straight path from the dominator
+        Epoch = c->npreds == 1 ? s->epoch : ++NumEpochs;
+        stack[sp] = (Visit){c, NumExprs, 0, first[c->id]};
+        number_block(c);
+        stack[sp++].epoch = Epoch;
+    }
+
+    free(first);
+    free(children);
+    free(stack);
+    free(Buckets);
+    free(Exprs);
+    ir_cleanup(f);
+}
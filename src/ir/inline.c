@@ -0,0 +1,367 @@
+/********************************************************************************
+ * File Name: src/ir/inline.c                                                   *
+ *                                                                              *
+ * Description: Inliner, replaces calls to small functions, and to functions    *
+ *              called from a single place, with a copy of their body. The      *
+ *              parameters become the arguments of the call and every return    *
+ *              jumps to the code after it.                                     *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ ********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+static IRprogram *Program; // Program being optimized
+
+/**
+ * Counts the calls to a function made by the direct code generator.
+ *
+ * @param n Node of the code
+ */
+static void count_direct_calls(ASTnode *n)
+{
+    IRfunc *c;
+
+    if (n == NULL)
+    {
+        return;
+    }
+    if (n->type == A_SEQ)
+    {
+        for (int i = 0; i < AST_VALUE(n).list->count; i++)
+        {
+            count_direct_calls(AST_NODE(AST_VALUE(n).list->item[i]));
+        }
+        return;
+    }
+    if (n->type == A_CALL && (c = ir_callee(Program, AST_VALUE(n).symbol)) != NULL)
+    {
+        c->calls++;
+    }
+    count_direct_calls(AST_LEFT(n));
+    count_direct_calls(AST_MID(n));
+    count_direct_calls(AST_RIGHT(n));
+}
+
+/**
+ * Counts the call sites of every function in the program.
+ *
+ * @param p The program
+ */
+static void count_calls(IRprogram *p)
+{
+    for (int i = 0; i < p->nfuncs; i++)
+    {
+        p->funcs[i]->calls = 0;
+    }
+    for (int i = 0; i < p->nfuncs; i++)
+    {
+        IRfunc *f = p->funcs[i];
+
+        for (int b = 0; b < f->nblocks; b++)
+        {
+            for (IRinstr *in = f->blocks[b]->first; in != NULL; in = in->next)
+            {
+                IRfunc *c = in->op == IR_CALL ? ir_callee(p, in->sym) : NULL;
+
+                if (c != NULL)
+                {
+                    c->calls++;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < p->ndirect; i++)
+    {
+        count_direct_calls(AST_LEFT(p->direct[i]));
+    }
+}
+
+/**
+ * Measures a function for the cost model, constants, parameters and jumps cost nothing.
+ *
+ * @param f The function
+ * @return Number of instructions that turn into code
+ */
+static int size(IRfunc *f)
+{
+    int n = 0;
+
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        for (IRinstr *in = f->blocks[i]->first; in != NULL; in = in->next)
+        {
+            n += in->op != IR_CONST && in->op != IR_PARAM && in->op != IR_JMP;
+        }
+    }
+    return n;
+}
+
+/**
+ * Decides if a call gets inlined, the reason goes to the report.
+ *
+ * @param f The caller
+ * @param call The call
+ * @param c The callee
+ * @return 1 to inline it
+ */
+static int should_inline(IRfunc *f, IRinstr *call, IRfunc *c)
+{
+    char *why = NULL;
+    int n = size(c);
+
+    if (c == f)
+    {
+        why = "recursive";
+    }
+    else if (call->nargs != c->sym->numParams)
+    {
+        why = "arguments beyond the registers";
+    }
+    else if (c->sym->inlining == INL_NEVER)
+    {
+        why = "noinline";
+    }
+    else if (c->sym->inlining == INL_AUTO && n > InlineThreshold && c->calls > 1)
+    {
+        why = "over the threshold";
+    }
+
+    if (OptReport)
+    {
+        fprintf(stderr, "%s %s into %s: %d instructions, %d call site%s%s%s\n", why ? "kept call to" : "inlined",
+                c->sym->name, f->sym ? f->sym->name : "top level", n, c->calls, c->calls == 1 ? "" : "s",
+                why ? ", " : "", why ? why : "");
+    }
+    return why == NULL;
+}
+
+/**
+ * Replaces a call with a copy of the body of the callee.
+ *
+ * @param f The caller
+ * @param call The call
+ * @param c The callee
+ * @return The block holding the code that followed the call
+ */
+static IRblock *inline_call(IRfunc *f, IRinstr *call, IRfunc *c)
+{
+    IRblock **blocks = (IRblock **)malloc((c->nblocks + 1) * sizeof(IRblock *));
+    int *values = (int *)malloc((c->nvalues + 1) * sizeof(int));
+    int *results = (int *)malloc((c->nblocks + 1) * sizeof(int));
+    IRblock *before = call->block, *after;
+    int nresults = 0, result = -1;
+
+    if (blocks == NULL || values == NULL || results == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+
+    // The code after the call goes on in a block of its own
+    after = ir_split_block(f, call);
+    for (int i = 0; i < c->nblocks; i++)
+    {
+        blocks[i] = ir_block(f);
+        blocks[i]->sealed = 1;
+    }
+
+    // Copy the instructions, parameters become the arguments
+    for (int i = 0; i < c->nblocks; i++)
+    {
+        for (IRinstr *in = c->blocks[i]->first; in != NULL; in = in->next)
+        {
+            IRinstr *copy;
+
+            if (in->op == IR_PARAM)
+            {
+                values[in->id] = call->args[in->imm];
+                continue;
+            }
+            copy = ir_instr(f, in->op == IR_RET ? IR_JMP : in->op, in->op == IR_RET ? 0 : in->nargs);
+            copy->imm = in->imm;
+            copy->sym = in->sym;
+            values[in->id] = copy->id;
+            ir_append(blocks[i], copy);
+        }
+    }
+    for (int i = 0; i < c->nblocks; i++)
+    {
+        IRblock *from = c->blocks[i], *to = blocks[i];
+        IRinstr *in, *copy;
+
+        for (in = from->first, copy = to->first; in != NULL; in = in->next)
+        {
+            if (in->op == IR_PARAM)
+            {
+                continue;
+            }
+            for (int a = 0; a < copy->nargs; a++)
+            {
+                copy->args[a] = values[in->args[a]];
+            }
+            copy = copy->next;
+        }
+        for (int p = 0; p < from->npreds; p++)
+        {
+            ir_add_pred(to, blocks[from->preds[p]->id]);
+        }
+        for (int s = 0; s < from->nsucc; s++)
+        {
+            ir_add_succ(to, blocks[from->succ[s]->id]);
+        }
+
+        // A return jumps past the call, bringing its value
+        if (from->last->op == IR_RET)
+        {
+            ir_edge(to, after);
+            results[nresults++] = from->last->nargs ? values[from->last->args[0]] : -1;
+        }
+    }
+
+    // The caller enters the copy through its first block
+    ir_append(before, ir_instr(f, IR_JMP, 0));
+    ir_edge(before, blocks[0]);
+
+    // The value of the call merges the returns, a return without value gives 0
+    for (int r = 0; r < nresults; r++)
+    {
+        if (results[r] == -1)
+        {
+            results[r] = ir_undef(f);
+        }
+    }
+    if (nresults == 1)
+    {
+        result = results[0];
+    }
+    else if (nresults > 1)
+    {
+        IRinstr *phi = ir_instr(f, IR_PHI, nresults);
+
+        for (int r = 0; r < nresults; r++)
+        {
+            phi->args[r] = results[r];
+        }
+        ir_insert_before(after->first, phi);
+        result = phi->id;
+    }
+    ir_replace(f, call->id, result != -1 ? result : ir_undef(f));
+    ir_remove(f, call);
+
+    free(blocks);
+    free(values);
+    free(results);
+    return after;
+}
+
+/**
+ * Inlines the calls of a function that the cost model picks. The copies are not looked at
+ * again, so a recursive callee only gets inlined one level deep.
+ *
+ * @param f The function
+ * @return 1 if any call was inlined
+ */
+static int inline_calls(IRfunc *f)
+{
+    int count = f->nblocks, changed = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        IRinstr *in, *next;
+
+        for (in = f->blocks[i]->first; in != NULL; in = next)
+        {
+            IRfunc *c = in->op == IR_CALL ? ir_callee(Program, in->sym) : NULL;
+
+            next = in->next;
+            if (c == NULL || !should_inline(f, in, c))
+            {
+                continue;
+            }
+            // Go on with the code that followed the call, it moved to a block of its own
+            next = inline_call(f, in, c)->first;
+            Stats.inlined++;
+            changed = 1;
+        }
+    }
+    return changed;
+}
+
+/**
+ * Adds a function to the order after the functions it calls.
+ *
+ * @param f The function
+ * @param order The order
+ * @param n Functions in the order
+ * @param seen Functions already visited, by index
+ */
+static void postorder(IRfunc *f, IRfunc **order, int *n, char *seen)
+{
+    for (int i = 0; i < Program->nfuncs; i++)
+    {
+        if (Program->funcs[i] == f)
+        {
+            if (seen[i])
+            {
+                return;
+            }
+            seen[i] = 1;
+        }
+    }
+    for (int b = 0; b < f->nblocks; b++)
+    {
+        for (IRinstr *in = f->blocks[b]->first; in != NULL; in = in->next)
+        {
+            IRfunc *c = in->op == IR_CALL ? ir_callee(Program, in->sym) : NULL;
+
+            if (c != NULL)
+            {
+                postorder(c, order, n, seen);
+            }
+        }
+    }
+    order[(*n)++] = f;
+}
+
+/**
+ * Inlines calls across the program. Callees are handled before their callers, so a caller
+ * gets the body of a callee with its own calls already inlined.
+ *
+ * @param p The program
+ */
+void ir_inline(IRprogram *p)
+{
+    IRfunc **order = (IRfunc **)malloc((p->nfuncs + 1) * sizeof(IRfunc *));
+    char *seen = (char *)calloc(p->nfuncs + 1, sizeof(char));
+    int n = 0;
+
+    if (order == NULL || seen == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+    Program = p;
+    count_calls(p);
+    for (int i = 0; i < p->nfuncs; i++)
+    {
+        postorder(p->funcs[i], order, &n, seen);
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        if (inline_calls(order[i]))
+        {
+            ir_cleanup(order[i]);
+            ir_verify(order[i]);
+        }
+    }
+    free(order);
+    free(seen);
+}
@@ -0,0 +1,990 @@
+/********************************************************************************
+ * File Name: src/ir/ir.c                                                       *
+ *                                                                              *
+ * Description: Intermediate Representation, three-address instructions in SSA  *
+ *              form grouped in basic blocks with an explicit CFG. Holds the    *
+ *              constructors, CFG clean-up, dominators and the text dump.       *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ ********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+// Operation names used by the dump
+static const char *const IRopStr[] = {
+    "const", "param", "phi",
+    "neg", "add", "sub", "mul", "div", "mod", "pow", "sext",
+    "not",
+    "eq", "ne", "lt", "le", "gt", "ge",
+    "load", "store",
+    "call", "print",
+    "jmp", "br", "switch", "ret"};
+
+/**
+ * Makes room for one more entry in an array living in the IR arena.
+ *
+ * @param p The array
+ * @param count Entries in use
+ * @param max Capacity, updated when the array grows
+ * @param elem Size of an entry
+ * @return The array, possibly moved
+ */
+static void *reserve(void *p, int count, int *max, size_t elem)
+{
+    if (count < *max)
+    {
+        return p;
+    }
+    int size = *max ? *max * 2 : 8;
+
+    p = arena_grow(&IrArena, p, *max * elem, size * elem);
+    *max = size;
+    return p;
+}
+
+/**
+ * Creates an empty function.
+ *
+ * @param sym Function symbol, NULL for the top-level code
+ * @return The function
+ */
+IRfunc *ir_func(Symbol *sym)
+{
+    IRfunc *f = (IRfunc *)arena_alloc(&IrArena, sizeof(IRfunc));
+
+    memset(f, 0, sizeof(IRfunc));
+    f->sym = sym;
+    return f;
+}
+
+/**
+ * Appends a new empty block to a function.
+ *
+ * @param f The function
+ * @return The block
+ */
+IRblock *ir_block(IRfunc *f)
+{
+    IRblock *b = (IRblock *)arena_alloc(&IrArena, sizeof(IRblock));
+
+    memset(b, 0, sizeof(IRblock));
+    b->id = f->nblocks;
+    b->rpo = -1;
+    b->label = NO_LABEL;
+    f->blocks = (IRblock **)reserve(f->blocks, f->nblocks, &f->maxblocks, sizeof(IRblock *));
+    f->blocks[f->nblocks++] = b;
+    return b;
+}
+
+/**
+ * Creates an instruction that is not yet placed in a block, it gets the next value number.
+ *
+ * @param f The function
+ * @param op The operation
+ * @param nargs Number of arguments, filled in by the caller
+ * @return The instruction
+ */
+IRinstr *ir_instr(IRfunc *f, IRop op, int nargs)
+{
+    IRinstr *in = (IRinstr *)arena_alloc(&IrArena, sizeof(IRinstr));
+    int max = f->maxvalues; // values and forward share the capacity
+
+    memset(in, 0, sizeof(IRinstr));
+    in->op = op;
+    in->id = f->nvalues;
+    in->nargs = nargs;
+    if (nargs > 0)
+    {
+        in->args = (int *)arena_alloc(&IrArena, nargs * sizeof(int));
+    }
+
+    f->values = (IRinstr **)reserve(f->values, f->nvalues, &f->maxvalues, sizeof(IRinstr *));
+    f->forward = (int *)reserve(f->forward, f->nvalues, &max, sizeof(int));
+    f->values[in->id] = in;
+    f->forward[in->id] = in->id;
+    f->nvalues++;
+    return in;
+}
+
+/**
+ * Adds an argument at the end of an instruction, used to fill phis.
+ *
+ * @param in The instruction
+ * @param v Value number of the argument
+ */
+void ir_add_arg(IRinstr *in, int v)
+{
+    in->args = (int *)arena_grow(&IrArena, in->args, in->nargs * sizeof(int), (in->nargs + 1) * sizeof(int));
+    in->args[in->nargs++] = v;
+}
+
+/**
+ * Places an instruction at the end of a block.
+ *
+ * @param b The block
+ * @param in The instruction
+ */
+void ir_append(IRblock *b, IRinstr *in)
+{
+    in->block = b;
+    in->prev = b->last;
+    in->next = NULL;
+    if (b->last != NULL)
+    {
+        b->last->next = in;
+    }
+    else
+    {
+        b->first = in;
+    }
+    b->last = in;
+}
+
+/**
+ * Places an instruction right before another one.
+ *
+ * @param pos The instruction that will follow it
+ * @param in The instruction
+ */
+void ir_insert_before(IRinstr *pos, IRinstr *in)
+{
+    IRblock *b = pos->block;
+
+    in->block = b;
+    in->prev = pos->prev;
+    in->next = pos;
+    if (pos->prev != NULL)
+    {
+        pos->prev->next = in;
+    }
+    else
+    {
+        b->first = in;
+    }
+    pos->prev = in;
+}
+
+/**
+ * Unlinks an instruction from its block, its value number is no longer defined.
+ *
+ * @param f The function
+ * @param in The instruction
+ */
+void ir_remove(IRfunc *f, IRinstr *in)
+{
+    IRblock *b = in->block;
+
+    if (in->prev != NULL)
+    {
+        in->prev->next = in->next;
+    }
+    else
+    {
+        b->first = in->next;
+    }
+    if (in->next != NULL)
+    {
+        in->next->prev = in->prev;
+    }
+    else
+    {
+        b->last = in->prev;
+    }
+    in->block = NULL;
+    f->values[in->id] = NULL;
+}
+
+/**
+ * Adds a CFG edge, the order of the edges matches the arguments of the phis.
+ *
+ * @param from Source block
+ * @param to Destination block
+ */
+void ir_edge(IRblock *from, IRblock *to)
+{
+    ir_add_succ(from, to);
+    ir_add_pred(to, from);
+}
+
+/**
+ * Adds a successor slot to a block, the predecessor side is left to the caller.
+ *
+ * @param b The block
+ * @param succ The successor
+ */
+void ir_add_succ(IRblock *b, IRblock *succ)
+{
+    b->succ = (IRblock **)reserve(b->succ, b->nsucc, &b->maxsucc, sizeof(IRblock *));
+    b->succ[b->nsucc++] = succ;
+}
+
+/**
+ * Adds a predecessor slot to a block, the successor side is left to the caller.
+ *
+ * @param b The block
+ * @param pred The predecessor
+ */
+void ir_add_pred(IRblock *b, IRblock *pred)
+{
+    b->preds = (IRblock **)reserve(b->preds, b->npreds, &b->maxpreds, sizeof(IRblock *));
+    b->preds[b->npreds++] = pred;
+}
+
+/**
+ * Drops one predecessor slot of a block and the phi arguments that belong to it.
+ *
+ * @param to The block
+ * @param from The predecessor, only its first slot goes if it has two
+ */
+static void drop_slot(IRblock *to, IRblock *from)
+{
+    int i = 0;
+
+    while (to->preds[i] != from)
+    {
+        i++;
+    }
+    for (; i + 1 < to->npreds; i++)
+    {
+        to->preds[i] = to->preds[i + 1];
+        for (IRinstr *in = to->first; in != NULL && in->op == IR_PHI; in = in->next)
+        {
+            in->args[i] = in->args[i + 1];
+        }
+    }
+    to->npreds--;
+    for (IRinstr *in = to->first; in != NULL && in->op == IR_PHI; in = in->next)
+    {
+        in->nargs--;
+    }
+}
+
+/**
+ * Removes one edge of a block and the phi arguments that come through it, the terminator is
+ * left to the caller.
+ *
+ * @param from Source block
+ * @param k Index of the edge among the successors
+ */
+void ir_remove_edge(IRblock *from, int k)
+{
+    drop_slot(from->succ[k], from);
+    from->nsucc--;
+    for (; k < from->nsucc; k++)
+    {
+        from->succ[k] = from->succ[k + 1];
+    }
+}
+
+/**
+ * Moves one edge of a block to another destination. The phis of the new destination get no
+ * argument for it, the caller adds them.
+ *
+ * @param from Source block
+ * @param k Index of the edge among the successors
+ * @param to New destination
+ */
+void ir_retarget(IRblock *from, int k, IRblock *to)
+{
+    drop_slot(from->succ[k], from);
+    from->succ[k] = to;
+    ir_add_pred(to, from);
+}
+
+/**
+ * Follows the replacements of a value.
+ *
+ * @param f The function
+ * @param v Value number
+ * @return The value that stands for it now
+ */
+int ir_resolve(IRfunc *f, int v)
+{
+    int r = v;
+
+    while (f->forward[r] != r)
+    {
+        r = f->forward[r];
+    }
+    // Shorten the chain for the next lookups
+    while (f->forward[v] != r)
+    {
+        int next = f->forward[v];
+
+        f->forward[v] = r;
+        v = next;
+    }
+    return r;
+}
+
+/**
+ * Makes every use of a value refer to another one, see ir_rewrite().
+ *
+ * @param f The function
+ * @param v Value being replaced
+ * @param with Its replacement
+ */
+void ir_replace(IRfunc *f, int v, int with)
+{
+    f->forward[v] = ir_resolve(f, with);
+}
+
+/**
+ * Applies the pending replacements to every argument.
+ *
+ * @param f The function
+ */
+void ir_rewrite(IRfunc *f)
+{
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        for (IRinstr *in = f->blocks[i]->first; in != NULL; in = in->next)
+        {
+            for (int a = 0; a < in->nargs; a++)
+            {
+                in->args[a] = ir_resolve(f, in->args[a]);
+            }
+        }
+    }
+}
+
+/**
+ * Checks if an operation ends a block.
+ *
+ * @param op The operation
+ * @return 1 if it is a terminator
+ */
+int ir_is_terminator(IRop op)
+{
+    return op == IR_JMP || op == IR_BR || op == IR_SWITCH || op == IR_RET;
+}
+
+/**
+ * Checks if an operation does something besides defining its value.
+ *
+ * @param op The operation
+ * @return 1 if it cannot be removed when its value is unused
+ */
+int ir_has_effects(IRop op)
+{
+    return op == IR_STORE || op == IR_CALL || op == IR_PRINT || ir_is_terminator(op);
+}
+
+/**
+ * Checks if a value already fits in 32 bits, so storing it into an int needs no extension.
+ *
+ * @param f The function
+ * @param v Value number
+ * @return 1 if the value is sign extended from 32 bits
+ */
+int ir_is_narrow(IRfunc *f, int v)
+{
+    IRinstr *in = f->values[ir_resolve(f, v)];
+
+    switch (in->op)
+    {
+    case IR_CONST:
+    case IR_SEXT:
+    case IR_PHI: // Merges values that went through write()
+    case IR_NOT:
+    case IR_EQ:
+    case IR_NE:
+    case IR_LT:
+    case IR_LE:
+    case IR_GT:
+    case IR_GE:
+        return 1;
+    case IR_LOAD:
+        return in->sym->size <= 4;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Creates a constant at the start of the entry block, where it dominates every use.
+ *
+ * @param f The function
+ * @param val The constant
+ * @return Value number
+ */
+int ir_const(IRfunc *f, int val)
+{
+    IRblock *entry = f->blocks[0];
+    IRinstr *in = ir_instr(f, IR_CONST, 0);
+
+    in->imm = val;
+    if (entry->first != NULL)
+    {
+        ir_insert_before(entry->first, in);
+    }
+    else
+    {
+        ir_append(entry, in);
+    }
+    return in->id;
+}
+
+/**
+ * Returns a value known to be 0, used for variables read before any assignment.
+ *
+ * @param f The function
+ * @return Value number of a constant 0 at the start of the entry block
+ */
+int ir_undef(IRfunc *f)
+{
+    return ir_const(f, 0);
+}
+
+/**
+ * Drops every edge coming from a block, with the phi arguments that belong to them.
+ *
+ * @param b Destination block
+ * @param pred The predecessor going away
+ */
+static void drop_pred(IRblock *b, IRblock *pred)
+{
+    int n = 0;
+
+    for (int i = 0; i < b->npreds; i++)
+    {
+        if (b->preds[i] == pred)
+        {
+            continue;
+        }
+        for (IRinstr *in = b->first; in != NULL && in->op == IR_PHI; in = in->next)
+        {
+            in->args[n] = in->args[i];
+        }
+        b->preds[n++] = b->preds[i];
+    }
+    for (IRinstr *in = b->first; in != NULL && in->op == IR_PHI; in = in->next)
+    {
+        in->nargs = n;
+    }
+    b->npreds = n;
+}
+
+/**
+ * Computes the reverse postorder of the reachable blocks.
+ *
+ * @param f The function
+ */
+static void number_blocks(IRfunc *f)
+{
+    IRblock **stack = (IRblock **)malloc(f->nblocks * sizeof(IRblock *));
+    int *next = (int *)calloc(f->nblocks, sizeof(int));
+    int sp = 0, n = f->nblocks;
+
+    if (stack == NULL || next == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        f->blocks[i]->rpo = -1;
+    }
+    f->order = (IRblock **)arena_alloc(&IrArena, f->nblocks * sizeof(IRblock *));
+
+    // Depth first walk, a block is numbered once all its successors are done. The last
+    // successor is walked first, so the first one ends up right after the block.
+    stack[sp++] = f->blocks[0];
+    f->blocks[0]->rpo = 0;
+    while (sp > 0)
+    {
+        IRblock *b = stack[sp - 1];
+
+        if (next[b->id] < b->nsucc)
+        {
+            IRblock *s = b->succ[b->nsucc - 1 - next[b->id]++];
+
+            if (s->rpo == -1)
+            {
+                s->rpo = 0;
+                stack[sp++] = s;
+            }
+            continue;
+        }
+        sp--;
+        f->order[--n] = b;
+    }
+
+    // Move the order to the start of the array
+    f->norder = f->nblocks - n;
+    memmove(f->order, f->order + n, f->norder * sizeof(IRblock *));
+    for (int i = 0; i < f->norder; i++)
+    {
+        f->order[i]->rpo = i;
+    }
+    free(stack);
+    free(next);
+}
+
+/**
+ * Deletes the blocks that cannot be reached from the entry.
+ *
+ * @param f The function
+ * @return 1 if any block was deleted
+ */
+static int remove_unreachable(IRfunc *f)
+{
+    int n = 0;
+
+    number_blocks(f);
+    if (f->norder == f->nblocks)
+    {
+        return 0;
+    }
+
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        IRblock *b = f->blocks[i];
+
+        if (b->rpo != -1)
+        {
+            continue;
+        }
+        for (int s = 0; s < b->nsucc; s++)
+        {
+            drop_pred(b->succ[s], b);
+        }
+        while (b->first != NULL)
+        {
+            ir_remove(f, b->first);
+        }
+    }
+
+    // Keep the surviving blocks in their original order
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        if (f->blocks[i]->rpo != -1)
+        {
+            f->blocks[i]->id = n;
+            f->blocks[n++] = f->blocks[i];
+        }
+    }
+    f->nblocks = n;
+    return 1;
+}
+
+/**
+ * Replaces the phis whose arguments are all the same value (or the phi itself).
+ *
+ * @param f The function
+ * @return 1 if any phi was replaced
+ */
+static int remove_trivial_phis(IRfunc *f)
+{
+    int changed = 0;
+
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        IRinstr *in = f->blocks[i]->first;
+
+        while (in != NULL && in->op == IR_PHI)
+        {
+            IRinstr *next = in->next;
+            int same = -1, trivial = 1;
+
+            for (int a = 0; a < in->nargs; a++)
+            {
+                int v = ir_resolve(f, in->args[a]);
+
+                if (v == in->id || v == same)
+                {
+                    continue;
+                }
+                if (same != -1)
+                {
+                    trivial = 0;
+                    break;
+                }
+                same = v;
+            }
+            if (trivial)
+            {
+                ir_replace(f, in->id, same != -1 ? same : ir_undef(f));
+                ir_remove(f, in);
+                changed = 1;
+            }
+            in = next;
+        }
+    }
+    if (changed)
+    {
+        ir_rewrite(f);
+    }
+    return changed;
+}
+
+/**
+ * Brings a function into canonical shape: replacements applied, no unreachable blocks and no
+ * trivial phis.
+ *
+ * @param f The function
+ */
+void ir_cleanup(IRfunc *f)
+{
+    int changed = 1;
+
+    ir_rewrite(f);
+    while (changed)
+    {
+        changed = remove_unreachable(f);
+        changed |= remove_trivial_phis(f);
+    }
+    number_blocks(f);
+}
+
+/**
+ * Puts a new block in the middle of an edge.
+ *
+ * @param f The function
+ * @param b Source block
+ * @param k Index of the edge among its successors
+ * @return The new block, it only jumps to the old destination
+ */
+IRblock *ir_split_edge(IRfunc *f, IRblock *b, int k)
+{
+    IRblock *s = b->succ[k];
+    IRblock *m = ir_block(f);
+
+    ir_append(m, ir_instr(f, IR_JMP, 0));
+    ir_add_succ(m, s);
+    ir_add_pred(m, b);
+    m->sealed = 1;
+    b->succ[k] = m;
+
+    // Same slot, so the phi arguments stay in place
+    for (int p = 0; p < s->npreds; p++)
+    {
+        if (s->preds[p] == b)
+        {
+            s->preds[p] = m;
+            break;
+        }
+    }
+    return m;
+}
+
+/**
+ * Moves the instructions that follow one to a new block, which takes over the successors. The
+ * old block is left without terminator.
+ *
+ * @param f The function
+ * @param in Last instruction staying in its block
+ * @return The new block
+ */
+IRblock *ir_split_block(IRfunc *f, IRinstr *in)
+{
+    IRblock *b = in->block, *after = ir_block(f);
+
+    after->sealed = 1;
+    while (in->next != NULL)
+    {
+        IRinstr *next = in->next;
+
+        ir_remove(f, next);
+        f->values[next->id] = next;
+        ir_append(after, next);
+    }
+
+    // Same slots in the successors, so their phis stay in place
+    for (int k = 0; k < b->nsucc; k++)
+    {
+        IRblock *s = b->succ[k];
+
+        for (int p = 0; p < s->npreds; p++)
+        {
+            if (s->preds[p] == b)
+            {
+                s->preds[p] = after;
+                break;
+            }
+        }
+    }
+    after->succ = b->succ;
+    after->nsucc = b->nsucc;
+    after->maxsucc = b->maxsucc;
+    b->succ = NULL;
+    b->nsucc = b->maxsucc = 0;
+    return after;
+}
+
+/**
+ * Finds the IR of a called function.
+ *
+ * @param p The program
+ * @param sym Function symbol
+ * @return Its IR, NULL if it is left to the direct code generator
+ */
+IRfunc *ir_callee(IRprogram *p, Symbol *sym)
+{
+    for (int i = 1; i < p->nfuncs; i++)
+    {
+        if (p->funcs[i]->sym == sym)
+        {
+            return p->funcs[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Checks if a function returns the value of a call right after it, maybe through a block that
+ * only returns. Nothing of the caller is needed once such a call starts.
+ *
+ * @param call The call
+ * @return 1 if the call is in tail position
+ */
+int ir_is_tail_call(IRinstr *call)
+{
+    IRinstr *next = call->next, *in;
+    IRblock *s;
+    int k = 0;
+
+    if (next->op == IR_RET)
+    {
+        return next->nargs == 0 || next->args[0] == call->id;
+    }
+    if (next->op != IR_JMP)
+    {
+        return 0;
+    }
+
+    // The successor returns at once, a phi may pick the value of the call on our edge
+    s = call->block->succ[0];
+    while (s->preds[k] != call->block)
+    {
+        k++;
+    }
+    in = s->first;
+    if (in->op == IR_RET)
+    {
+        return in->nargs == 0;
+    }
+    return in->op == IR_PHI && in->args[k] == call->id && in->next->op == IR_RET && in->next->nargs == 1 &&
+           in->next->args[0] == in->id;
+}
+
+/**
+ * Splits the edges going from a block with two or more successors to a block with two or more
+ * predecessors, so the copies of the phis have a block of their own.
+ *
+ * @param f The function
+ * @param keep Decides the edges of a branch left alone, their copies go before it. NULL splits all
+ */
+void ir_split_edges(IRfunc *f, int (*keep)(IRblock *, int))
+{
+    int count = f->nblocks;
+
+    for (int i = 0; i < count; i++)
+    {
+        IRblock *b = f->blocks[i];
+        int split[2];
+
+        if (b->nsucc < 2)
+        {
+            continue;
+        }
+        if (b->last->op == IR_SWITCH)
+        {
+            // Edges into blocks without phis have no copies to make
+            for (int k = 0; k < b->nsucc; k++)
+            {
+                if (b->succ[k]->npreds >= 2 && b->succ[k]->first->op == IR_PHI)
+                {
+                    ir_split_edge(f, b, k);
+                }
+            }
+            continue;
+        }
+        // Decided before splitting, keep() sees the blocks as they were
+        for (int k = 0; k < 2; k++)
+        {
+            split[k] = b->succ[k]->npreds >= 2 && (keep == NULL || !keep(b, k));
+        }
+        for (int k = 0; k < 2; k++)
+        {
+            if (split[k])
+            {
+                ir_split_edge(f, b, k);
+            }
+        }
+    }
+    number_blocks(f);
+}
+
+/**
+ * Finds the nearest common dominator of two blocks.
+ *
+ * @param a First block
+ * @param b Second block
+ * @return The common dominator
+ */
+static IRblock *intersect(IRblock *a, IRblock *b)
+{
+    while (a != b)
+    {
+        while (a->rpo > b->rpo)
+        {
+            a = a->idom;
+        }
+        while (b->rpo > a->rpo)
+        {
+            b = b->idom;
+        }
+    }
+    return a;
+}
+
+/**
+ * Computes the reverse postorder and the immediate dominator of every reachable block
+ * (Cooper, Harvey and Kennedy).
+ *
+ * @param f The function
+ */
+void ir_dominators(IRfunc *f)
+{
+    int changed = 1;
+
+    number_blocks(f);
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        f->blocks[i]->idom = NULL;
+    }
+    f->order[0]->idom = f->order[0];
+
+    while (changed)
+    {
+        changed = 0;
+        for (int i = 1; i < f->norder; i++)
+        {
+            IRblock *b = f->order[i];
+            IRblock *idom = NULL;
+
+            for (int p = 0; p < b->npreds; p++)
+            {
+                IRblock *pred = b->preds[p];
+
+                if (pred->idom == NULL)
+                {
+                    continue;
+                }
+                idom = idom == NULL ? pred : intersect(pred, idom);
+            }
+            if (idom != b->idom)
+            {
+                b->idom = idom;
+                changed = 1;
+            }
+        }
+    }
+}
+
+/**
+ * Checks dominance, needs ir_dominators().
+ *
+ * @param a The dominator candidate
+ * @param b The block
+ * @return 1 if every path from the entry to b goes through a
+ */
+int ir_dominates(IRblock *a, IRblock *b)
+{
+    while (b->rpo > a->rpo)
+    {
+        b = b->idom;
+    }
+    return a == b;
+}
+
+/**
+ * Writes a function in text form.
+ *
+ * @param f The function
+ * @param out Destination file
+ */
+void ir_dump(IRfunc *f, FILE *out)
+{
+    if (f->sym != NULL)
+    {
+        fprintf(out, "fun %s(", f->sym->name);
+        Symbol *param = f->sym->params;
+
+        for (int i = 0; i < f->sym->numParams; i++, param = param->next)
+        {
+            fprintf(out, "%s%s", i ? ", " : "", param->name);
+        }
+        fprintf(out, "):\n");
+    }
+    else
+    {
+        fprintf(out, "top level:\n");
+    }
+
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        IRblock *b = f->blocks[i];
+
+        fprintf(out, "  B%d:", b->id);
+        for (int p = 0; p < b->npreds; p++)
+        {
+            fprintf(out, "%s B%d", p ? "," : " ; preds", b->preds[p]->id);
+        }
+        fprintf(out, "\n");
+
+        for (IRinstr *in = b->first; in != NULL; in = in->next)
+        {
+            fprintf(out, "    ");
+            if (!ir_has_effects(in->op) || in->op == IR_CALL)
+            {
+                fprintf(out, "v%d = ", in->id);
+            }
+            fprintf(out, "%s", IRopStr[in->op]);
+
+            switch (in->op)
+            {
+            case IR_CONST:
+            case IR_PARAM:
+                fprintf(out, " %d", in->imm);
+                break;
+            case IR_PHI:
+                for (int a = 0; a < in->nargs; a++)
+                {
+                    fprintf(out, "%s [v%d, B%d]", a ? "," : "", in->args[a], b->preds[a]->id);
+                }
+                break;
+            case IR_LOAD:
+            case IR_STORE:
+            case IR_CALL:
+                fprintf(out, " %s", in->sym->name);
+                for (int a = 0; a < in->nargs; a++)
+                {
+                    fprintf(out, ", v%d", in->args[a]);
+                }
+                break;
+            default:
+                for (int a = 0; a < in->nargs; a++)
+                {
+                    fprintf(out, "%s v%d", a ? "," : "", in->args[a]);
+                }
+                break;
+            }
+            for (int s = 0; ir_is_terminator(in->op) && s < b->nsucc; s++)
+            {
+                fprintf(out, "%s B%d", s || in->nargs ? "," : "", b->succ[s]->id);
+            }
+            fprintf(out, "\n");
+        }
+    }
+    fprintf(out, "\n");
+}
@@ -0,0 +1,421 @@
+/********************************************************************************
+ * File Name: src/ir/licm.c                                                     *
+ *                                                                              *
+ * Description: Loop-Invariant Code Motion, finds the natural loops of a        *
+ *              function and moves the computations that give the same value    *
+ *              on every iteration to a preheader that runs once before the     *
+ *              loop. Also finds the functions whose calls can be moved.        *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ ********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+// Natural loop, the blocks that reach a back edge without going through the header
+typedef struct Loop
+{
+    IRblock *header;     // Target of the back edges
+    IRblock **blocks;    // Blocks of the loop, nested loops included
+    int nblocks;         // Number of blocks
+    int maxblocks;       // Capacity of blocks
+    int parent;          // Innermost loop around this one, -1 if none
+} Loop;
+
+static IRprogram *Program; // Program being optimized
+static Loop *Loops;        // Loops of the function, innermost first
+static int NumLoops;
+static int *Innermost;     // Innermost loop of every block, -1 outside any loop
+
+/**
+ * Checks if a function has no effects and always returns. Loops and recursion could run forever,
+ * so moving a call to a place where it did not run before would not be safe.
+ *
+ * @param f The function
+ * @return 1 if it is pure
+ */
+static int is_pure(IRfunc *f)
+{
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        IRblock *b = f->blocks[i];
+
+        for (int s = 0; s < b->nsucc; s++)
+        {
+            if (b->succ[s]->rpo <= b->rpo)
+            {
+                return 0;
+            }
+        }
+        for (IRinstr *in = b->first; in != NULL; in = in->next)
+        {
+            IRfunc *c = in->op == IR_CALL ? ir_callee(Program, in->sym) : NULL;
+
+            switch (in->op)
+            {
+            case IR_STORE:
+            case IR_PRINT:
+                return 0;
+            case IR_CALL:
+                if (c == NULL || !c->pure)
+                {
+                    return 0;
+                }
+                f->loads |= c->loads;
+                break;
+            case IR_LOAD:
+                f->loads = 1;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    return 1;
+}
+
+/**
+ * Finds the pure functions of a program, a function is only pure once all its callees are.
+ *
+ * @param p The program
+ */
+void ir_find_pure(IRprogram *p)
+{
+    int changed = 1;
+
+    Program = p;
+    while (changed)
+    {
+        changed = 0;
+        for (int i = 1; i < p->nfuncs; i++)
+        {
+            IRfunc *f = p->funcs[i];
+
+            if (!f->pure && is_pure(f))
+            {
+                f->pure = 1;
+                changed = 1;
+            }
+        }
+    }
+}
+
+/**
+ * Adds a block to a loop.
+ *
+ * @param l The loop
+ * @param b The block
+ */
+static void add_block(Loop *l, IRblock *b)
+{
+    if (l->nblocks == l->maxblocks)
+    {
+        l->maxblocks = l->maxblocks ? l->maxblocks * 2 : 8;
+        l->blocks = (IRblock **)realloc(l->blocks, l->maxblocks * sizeof(IRblock *));
+        if (l->blocks == NULL)
+        {
+            fprintf(stderr, "Fatal Error: out of memory\n");
+            exit(1);
+        }
+    }
+    l->blocks[l->nblocks++] = b;
+}
+
+/**
+ * Orders loops from the smallest to the largest.
+ *
+ * @param a First loop
+ * @param b Second loop
+ * @return Negative, zero or positive like strcmp()
+ */
+static int by_size(const void *a, const void *b)
+{
+    return ((const Loop *)a)->nblocks - ((const Loop *)b)->nblocks;
+}
+
+/**
+ * Checks if a block belongs to a loop.
+ *
+ * @param b The block
+ * @param l Index of the loop
+ * @return 1 if it is in the loop or in a loop nested in it
+ */
+static int in_loop(IRblock *b, int l)
+{
+    for (int k = Innermost[b->id]; k != -1; k = Loops[k].parent)
+    {
+        if (k == l)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Finds the natural loops of a function and how they nest.
+ *
+ * @param f The function
+ */
+static void find_loops(IRfunc *f)
+{
+    int *seen = (int *)calloc(f->nblocks + 1, sizeof(int));
+    IRblock **work = (IRblock **)malloc((f->nblocks + 1) * sizeof(IRblock *));
+
+    Loops = (Loop *)malloc((f->nblocks + 1) * sizeof(Loop));
+    Innermost = (int *)malloc((f->nblocks * 2 + 1) * sizeof(int));
+    if (seen == NULL || work == NULL || Loops == NULL || Innermost == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+    NumLoops = 0;
+    ir_dominators(f);
+
+    // A back edge goes to a block that dominates its source
+    for (int i = 0; i < f->norder; i++)
+    {
+        IRblock *h = f->order[i];
+        Loop *l = &Loops[NumLoops];
+        int n = 0, back = 0;
+
+        l->header = h;
+        l->blocks = NULL;
+        l->nblocks = l->maxblocks = 0;
+        l->parent = -1;
+        seen[h->id] = i + 1;
+        for (int p = 0; p < h->npreds; p++)
+        {
+            if (!ir_dominates(h, h->preds[p]))
+            {
+                continue;
+            }
+            back = 1;
+            if (seen[h->preds[p]->id] != i + 1)
+            {
+                seen[h->preds[p]->id] = i + 1;
+                work[n++] = h->preds[p];
+            }
+        }
+        if (!back)
+        {
+            continue;
+        }
+        add_block(l, h);
+        while (n > 0)
+        {
+            IRblock *b = work[--n];
+
+            add_block(l, b);
+            for (int p = 0; p < b->npreds; p++)
+            {
+                if (seen[b->preds[p]->id] != i + 1)
+                {
+                    seen[b->preds[p]->id] = i + 1;
+                    work[n++] = b->preds[p];
+                }
+            }
+        }
+        NumLoops++;
+    }
+    qsort(Loops, NumLoops, sizeof(Loop), by_size);
+
+    // The smallest loop holding a block is its innermost one
+    for (int i = 0; i < f->nblocks * 2; i++)
+    {
+        Innermost[i] = -1;
+    }
+    for (int l = 0; l < NumLoops; l++)
+    {
+        for (int i = 0; i < Loops[l].nblocks; i++)
+        {
+            int k = Innermost[Loops[l].blocks[i]->id];
+
+            if (k == -1)
+            {
+                Innermost[Loops[l].blocks[i]->id] = l;
+                continue;
+            }
+            while (Loops[k].parent != -1)
+            {
+                k = Loops[k].parent;
+            }
+            if (k != l)
+            {
+                Loops[k].parent = l;
+            }
+        }
+    }
+    free(seen);
+    free(work);
+}
+
+/**
+ * Finds or creates the block that runs right before a loop.
+ *
+ * @param f The function
+ * @param l Index of the loop
+ * @return The preheader, NULL if the loop is entered from more than one place
+ */
+static IRblock *preheader(IRfunc *f, int l)
+{
+    IRblock *h = Loops[l].header, *outside = NULL, *p;
+    int count = 0, k = 0;
+
+    for (int i = 0; i < h->npreds; i++)
+    {
+        if (!in_loop(h->preds[i], l))
+        {
+            outside = h->preds[i];
+            count++;
+        }
+    }
+    if (count != 1)
+    {
+        return NULL;
+    }
+    if (outside->nsucc == 1)
+    {
+        return outside;
+    }
+
+    while (outside->succ[k] != h)
+    {
+        k++;
+    }
+    p = ir_split_edge(f, outside, k);
+    Innermost[p->id] = Loops[l].parent;
+    for (int k = Loops[l].parent; k != -1; k = Loops[k].parent)
+    {
+        add_block(&Loops[k], p);
+    }
+    return p;
+}
+
+/**
+ * Moves the invariant computations of a loop to its preheader.
+ *
+ * @param f The function
+ * @param l Index of the loop
+ */
+static void hoist_loop(IRfunc *f, int l)
+{
+    Loop *loop = &Loops[l];
+    Symbol **stores = (Symbol **)malloc((f->nvalues + 1) * sizeof(Symbol *));
+    int nstores = 0, impure = 0, changed = 1;
+    IRblock *pre = NULL;
+
+    if (stores == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+
+    // What the loop may change in memory
+    for (int i = 0; i < loop->nblocks; i++)
+    {
+        for (IRinstr *in = loop->blocks[i]->first; in != NULL; in = in->next)
+        {
+            if (in->op == IR_STORE)
+            {
+                stores[nstores++] = in->sym;
+            }
+            else if (in->op == IR_CALL)
+            {
+                IRfunc *c = ir_callee(Program, in->sym);
+
+                impure |= c == NULL || !c->pure;
+            }
+        }
+    }
+
+    // Moving a value can make the ones using it invariant, so repeat until nothing moves
+    while (changed)
+    {
+        changed = 0;
+        for (int i = 0; i < loop->nblocks; i++)
+        {
+            IRinstr *in, *next;
+
+            for (in = loop->blocks[i]->first; in != NULL; in = next)
+            {
+                IRfunc *c = in->op == IR_CALL ? ir_callee(Program, in->sym) : NULL;
+                int invariant = 1;
+
+                next = in->next;
+                // Constants cost nothing, they only move so the values using them can
+                switch (in->op)
+                {
+                case IR_PARAM:
+                case IR_PHI:
+                case IR_STORE:
+                case IR_PRINT:
+                case IR_JMP:
+                case IR_BR:
+                case IR_SWITCH:
+                case IR_RET:
+                    continue;
+                case IR_LOAD:
+                    invariant = !impure;
+                    for (int s = 0; s < nstores; s++)
+                    {
+                        invariant &= stores[s] != in->sym;
+                    }
+                    break;
+                case IR_CALL:
+                    invariant = c != NULL && c->pure && (!c->loads || (!impure && nstores == 0));
+                    break;
+                default:
+                    break;
+                }
+                for (int a = 0; invariant && a < in->nargs; a++)
+                {
+                    invariant = !in_loop(f->values[in->args[a]]->block, l);
+                }
+                if (!invariant)
+                {
+                    continue;
+                }
+
+                if (pre == NULL && (pre = preheader(f, l)) == NULL)
+                {
+                    free(stores);
+                    return;
+                }
+                ir_remove(f, in);
+                f->values[in->id] = in;
+                ir_insert_before(pre->last, in);
+                Stats.hoisted += in->op != IR_CONST;
+                changed = 1;
+            }
+        }
+    }
+    free(stores);
+}
+
+/**
+ * Moves the loop-invariant code of a function out of its loops, inner loops first so their
+ * code can keep moving out of the loops around them. Needs ir_find_pure().
+ *
+ * @param f The function
+ */
+void ir_licm(IRfunc *f)
+{
+    find_loops(f);
+    for (int l = 0; l < NumLoops; l++)
+    {
+        hoist_loop(f, l);
+    }
+    for (int l = 0; l < NumLoops; l++)
+    {
+        free(Loops[l].blocks);
+    }
+    free(Loops);
+    free(Innermost);
+    ir_cleanup(f);
+}
@@ -0,0 +1,789 @@
+/********************************************************************************
+ * File Name: src/ir/lower.c                                                    *
+ *                                                                              *
+ * Description: IR Lowering, drives the Backend interface from the SSA form.    *
+ *              Values used once and close to their definition stay in a        *
+ *              register, the rest live in stack slots; phis become copies at   *
+ *              the end of their predecessors.                                  *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ ********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+#define MAX_LIVE 4 // Values kept in registers at once, the backend needs the other three
+
+static IRfunc *Func;     // Function being lowered
+static int *Uses;        // Number of uses of every value
+static int *InReg;       // 1 if the value goes from its definition to its use in a register
+static int *Slot;        // Stack offset of the values living in memory, 0 if none
+static int *Reg;         // Register holding a value, NO_REG if none
+static int *Temp;        // Offsets of the slots used by conflicting phi copies
+static int FrameSize;    // Bytes of stack slots
+static int ExitLabel;    // End of the top-level code
+static Symbol SlotSym;   // Stand-in symbol handed to the backend for a slot
+static IRinstr *Fused;   // Comparison lowered with the branch ending its block, NULL if none
+static IRinstr *Parity;  // x % 2 compared with 0 by Fused, lowered as a test of bit 0
+
+// Condition of every comparison, in the order they follow IR_EQ
+static const Cond Conds[] = {C_EQ, C_NE, C_LT, C_LE, C_GT, C_GE};
+
+/**
+ * Allocates a zeroed array.
+ *
+ * @param count Number of entries
+ * @param size Size of an entry
+ * @return The array
+ */
+static void *zalloc(int count, size_t size)
+{
+    void *p = calloc(count + 1, size);
+
+    if (p == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+/**
+ * Points the stand-in symbol at a stack slot.
+ *
+ * @param offset Offset of the slot
+ * @return The symbol
+ */
+static Symbol *slot(int offset)
+{
+    SlotSym.size = 8;
+    SlotSym.offset = offset;
+    return &SlotSym;
+}
+
+/**
+ * Checks if an operation may clobber the temporary registers.
+ *
+ * @param op The operation
+ * @return 1 for calls and prints
+ */
+static int clobbers(IRop op)
+{
+    return op == IR_CALL || op == IR_PRINT;
+}
+
+/**
+ * Decides where every value lives. A value stays in a register when its only use is later in
+ * the same block, no call or print comes in between and few values are already waiting.
+ * Values of a single block share a pool of slots, the others get a slot of their own.
+ */
+static void assign_storage(void)
+{
+    int *user = (int *)zalloc(Func->nvalues, sizeof(int));   // Block of the only use, -1 if several
+    int *local = (int *)zalloc(Func->nvalues, sizeof(int));  // Uses left in the block of a pool value
+    int *pending = (int *)zalloc(MAX_LIVE, sizeof(int));     // Values waiting in registers
+    int *pool = (int *)zalloc(Func->nvalues, sizeof(int));   // Free pool slots (indexes)
+    int nglobal = 0, poolMax = 0, maxPhis = 0;
+
+    // Uses and the block of the only use
+    for (int v = 0; v < Func->nvalues; v++)
+    {
+        user[v] = -2;
+    }
+    for (int i = 0; i < Func->norder; i++)
+    {
+        IRblock *b = Func->order[i];
+        int phis = 0;
+
+        for (IRinstr *in = b->first; in != NULL; in = in->next)
+        {
+            phis += in->op == IR_PHI;
+            for (int a = 0; a < in->nargs; a++)
+            {
+                int v = in->args[a];
+
+                Uses[v]++;
+                user[v] = (user[v] == -2 && in->op != IR_PHI) ? b->id : -1;
+            }
+        }
+        if (phis > maxPhis)
+        {
+            maxPhis = phis;
+        }
+    }
+
+    // Registers, walking every block in order
+    for (int i = 0; i < Func->norder; i++)
+    {
+        IRblock *b = Func->order[i];
+        int npending = 0;
+
+        for (IRinstr *in = b->first; in != NULL; in = in->next)
+        {
+            // Operands leave the waiting list
+            for (int a = 0; a < in->nargs; a++)
+            {
+                for (int p = 0; p < npending; p++)
+                {
+                    if (pending[p] == in->args[a])
+                    {
+                        pending[p] = pending[--npending];
+                        break;
+                    }
+                }
+            }
+            // Nothing waiting survives a call
+            if (clobbers(in->op))
+            {
+                for (int p = 0; p < npending; p++)
+                {
+                    InReg[pending[p]] = 0;
+                }
+                npending = 0;
+            }
+            if (in->op != IR_PHI && in->op != IR_PARAM && in->op != IR_CONST && Uses[in->id] == 1 &&
+                user[in->id] == b->id && npending < MAX_LIVE)
+            {
+                InReg[in->id] = 1;
+                pending[npending++] = in->id;
+            }
+        }
+    }
+
+    // Slots of the values used in other blocks
+    for (int v = 0; v < Func->nvalues; v++)
+    {
+        IRinstr *in = Func->values[v];
+
+        if (in == NULL || in->op == IR_CONST || InReg[v] || Uses[v] == 0)
+        {
+            continue;
+        }
+        if (in->op == IR_PHI || in->op == IR_PARAM || user[v] != in->block->id)
+        {
+            Slot[v] = -8 * ++nglobal;
+        }
+    }
+
+    // Pool slots, taken at the definition and given back after the last use
+    for (int i = 0; i < Func->norder; i++)
+    {
+        IRblock *b = Func->order[i];
+        int nfree = 0, used = 0;
+
+        for (IRinstr *in = b->first; in != NULL; in = in->next)
+        {
+            for (int a = 0; a < in->nargs; a++)
+            {
+                int v = in->args[a];
+
+                if (local[v] > 0 && --local[v] == 0)
+                {
+                    pool[nfree++] = Slot[v];
+                }
+            }
+            if (Slot[in->id] == 0 && !InReg[in->id] && Uses[in->id] > 0 && in->op != IR_CONST)
+            {
+                Slot[in->id] = nfree > 0 ? pool[--nfree] : -8 * (nglobal + ++used);
+                local[in->id] = Uses[in->id];
+            }
+        }
+        if (used > poolMax)
+        {
+            poolMax = used;
+        }
+    }
+
+    // Conflicting phi copies go through temporaries that follow everything else
+    for (int p = 0; p < maxPhis; p++)
+    {
+        Temp[p] = -8 * (nglobal + poolMax + p + 1);
+    }
+    FrameSize = 8 * (nglobal + poolMax + maxPhis);
+
+    free(user);
+    free(local);
+    free(pending);
+    free(pool);
+}
+
+/**
+ * Loads a value into a register.
+ *
+ * @param v Value number
+ * @return The register, owned by the caller
+ */
+static int operand(int v)
+{
+    IRinstr *def = Func->values[v];
+    int r;
+
+    if (def->op == IR_CONST)
+    {
+        return CG->load_int(def->imm);
+    }
+    if (Reg[v] != NO_REG)
+    {
+        r = Reg[v];
+        Reg[v] = NO_REG;
+        return r;
+    }
+    return CG->load_local(slot(Slot[v]));
+}
+
+/**
+ * Keeps the value computed by an instruction where it lives.
+ *
+ * @param in The instruction
+ * @param r Register holding the value, it is given up
+ */
+static void result(IRinstr *in, int r)
+{
+    if (Uses[in->id] == 0)
+    {
+        CG->free_register(r);
+    }
+    else if (InReg[in->id])
+    {
+        Reg[in->id] = r;
+    }
+    else
+    {
+        CG->store_local(r, slot(Slot[in->id]));
+        CG->free_register(r);
+    }
+}
+
+/**
+ * Copies the arguments of the phis of a successor into their slots. When a phi reads another
+ * phi of the same block the copies go through temporaries, so all of them see the old values.
+ *
+ * @param b Block ending with the jump
+ * @param s The successor
+ */
+static void phi_copies(IRblock *b, IRblock *s)
+{
+    int k = 0, conflict = 0, n = 0;
+
+    while (s->preds[k] != b)
+    {
+        k++;
+    }
+    for (IRinstr *phi = s->first; phi != NULL && phi->op == IR_PHI; phi = phi->next)
+    {
+        IRinstr *def = Func->values[phi->args[k]];
+
+        conflict |= def->op == IR_PHI && def->block == s && def != phi;
+    }
+
+    for (IRinstr *phi = s->first; phi != NULL && phi->op == IR_PHI; phi = phi->next, n++)
+    {
+        int r;
+
+        if (phi->args[k] == phi->id || Uses[phi->id] == 0)
+        {
+            continue;
+        }
+        r = operand(phi->args[k]);
+        CG->store_local(r, slot(conflict ? Temp[n] : Slot[phi->id]));
+        CG->free_register(r);
+    }
+    if (!conflict)
+    {
+        return;
+    }
+    n = 0;
+    for (IRinstr *phi = s->first; phi != NULL && phi->op == IR_PHI; phi = phi->next, n++)
+    {
+        int r;
+
+        if (phi->args[k] == phi->id || Uses[phi->id] == 0)
+        {
+            continue;
+        }
+        r = CG->load_local(slot(Temp[n]));
+        CG->store_local(r, slot(Slot[phi->id]));
+        CG->free_register(r);
+    }
+}
+
+/**
+ * Looks for a comparison that only feeds the branch right after it, the branch then uses the
+ * flags instead of a 0/1 value.
+ *
+ * @param b The block
+ */
+static void fuse_compare(IRblock *b)
+{
+    IRinstr *br = b->last, *c = br->prev, *left, *right;
+
+    Fused = Parity = NULL;
+    if (br->op != IR_BR || c == NULL || c->id != br->args[0] || c->op < IR_EQ || c->op > IR_GE ||
+        Uses[c->id] != 1)
+    {
+        return;
+    }
+    Fused = c;
+    left = Func->values[c->args[0]];
+    right = Func->values[c->args[1]];
+    if ((c->op == IR_EQ || c->op == IR_NE) && right->op == IR_CONST && right->imm == 0 && left == c->prev &&
+        left->op == IR_MOD && Uses[left->id] == 1 && Func->values[left->args[1]]->op == IR_CONST &&
+        Func->values[left->args[1]]->imm == 2)
+    {
+        Parity = left;
+    }
+}
+
+/**
+ * Branches on the condition of a block.
+ *
+ * @param r Register of the condition, or of the left operand of the fused comparison, it is freed
+ * @param r2 Register of the right operand, NO_REG if it is a constant or nothing was fused
+ * @param sense 1 to branch when the condition holds, 0 when it does not
+ * @param l The destination label
+ */
+static void branch_on(int r, int r2, int sense, int l)
+{
+    Cond cond;
+
+    if (Fused == NULL)
+    {
+        if (sense)
+        {
+            CG->jump_true(r, l);
+        }
+        else
+        {
+            CG->jump_cond(r, l);
+        }
+        CG->free_register(r);
+        return;
+    }
+    cond = Conds[Fused->op - IR_EQ] ^ !sense;
+    if (Parity != NULL)
+    {
+        CG->bit_jump(r, 0, cond, l);
+    }
+    else if (r2 != NO_REG)
+    {
+        CG->cmp_jump(r, r2, cond, l);
+    }
+    else
+    {
+        CG->cmp_jump_const(r, Func->values[Fused->args[1]]->imm, cond, l);
+    }
+}
+
+/**
+ * Decides if the copies of an edge out of a branch can run before it, so the edge needs no
+ * block of its own. Either there are no copies, or the edge goes back to a loop header and
+ * nothing on the way out reads the phis they overwrite. Needs ir_dominators().
+ *
+ * @param b Block ending with the branch
+ * @param k Index of the edge among its successors
+ * @return 1 to keep the edge
+ */
+static int early_copies(IRblock *b, int k)
+{
+    IRblock *h = b->succ[k], *e = b->succ[1 - k];
+    int p = 0;
+
+    if (h->first->op != IR_PHI)
+    {
+        return 1;
+    }
+    // Outside the loop the old values are only read by the copies of the other edge
+    if (!ir_dominates(h, b) || ir_dominates(h, e))
+    {
+        return 0;
+    }
+    while (e->preds[p] != b)
+    {
+        p++;
+    }
+    for (IRinstr *phi = e->first; phi != NULL && phi->op == IR_PHI; phi = phi->next)
+    {
+        IRinstr *def = Func->values[phi->args[p]];
+
+        if (def->op == IR_PHI && def->block == h)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Lowers the terminator of a block.
+ *
+ * @param in The terminator
+ * @param next Block laid out next, or NULL
+ */
+static void lower_terminator(IRinstr *in, IRblock *next)
+{
+    IRblock *b = in->block;
+
+    switch (in->op)
+    {
+    case IR_JMP:
+        phi_copies(b, b->succ[0]);
+        if (b->succ[0] != next)
+        {
+            CG->jump(b->succ[0]->label);
+        }
+        return;
+    case IR_BR:
+    {
+        int r, r2 = NO_REG;
+
+        // Operands first, the copies may overwrite them
+        if (Fused == NULL)
+        {
+            r = operand(in->args[0]);
+        }
+        else if (Parity != NULL)
+        {
+            r = operand(Parity->args[0]);
+        }
+        else
+        {
+            r = operand(Fused->args[0]);
+            if (Func->values[Fused->args[1]]->op != IR_CONST)
+            {
+                r2 = operand(Fused->args[1]);
+            }
+        }
+
+        // Copies of the edges kept by ir_split_edges()
+        phi_copies(b, b->succ[0]);
+        phi_copies(b, b->succ[1]);
+        if (b->succ[0] == next)
+        {
+            branch_on(r, r2, 0, b->succ[1]->label);
+        }
+        else
+        {
+            branch_on(r, r2, 1, b->succ[0]->label);
+            if (b->succ[1] != next)
+            {
+                CG->jump(b->succ[1]->label);
+            }
+        }
+        return;
+    }
+    case IR_SWITCH:
+    {
+        int n = in->nargs - 1, r = operand(in->args[0]);
+        int *vals = (int *)malloc((n + 1) * sizeof(int)), *labels = (int *)malloc((n + 1) * sizeof(int));
+
+        if (vals == NULL || labels == NULL)
+        {
+            fprintf(stderr, "Fatal Error: out of memory\n");
+            exit(1);
+        }
+        // Edges into phis were split, these copies only reach blocks entered from here
+        for (int k = 0; k < b->nsucc; k++)
+        {
+            phi_copies(b, b->succ[k]);
+        }
+        for (int k = 0; k < n; k++)
+        {
+            vals[k] = Func->values[in->args[k + 1]]->imm;
+            labels[k] = b->succ[k]->label;
+        }
+        CG->switch_jump(r, vals, labels, n, b->succ[n]->label);
+        free(vals);
+        free(labels);
+        return;
+    }
+    default:
+        if (in->nargs > 0)
+        {
+            int r = operand(in->args[0]);
+
+            CG->ret(r);
+            CG->free_register(r);
+        }
+        if (Func->sym != NULL)
+        {
+            CG->postamble(FrameSize);
+        }
+        else if (next != NULL)
+        {
+            CG->jump(ExitLabel);
+        }
+        return;
+    }
+}
+
+/**
+ * Lowers a multiplication, division, modulo or power by a constant, the backend turns it into
+ * shifts, a multiply by the reciprocal or a chain of multiplies.
+ *
+ * @param in The instruction
+ * @return 1 if it was lowered, 0 if no operand is constant
+ */
+static int lower_by_const(IRinstr *in)
+{
+    IRinstr *left = Func->values[in->args[0]], *right = Func->values[in->args[1]];
+
+    // The factors of a multiplication can swap
+    if (in->op == IR_MUL && right->op != IR_CONST && left->op == IR_CONST)
+    {
+        IRinstr *t = left;
+
+        left = right;
+        right = t;
+    }
+    if (right->op != IR_CONST)
+    {
+        return 0;
+    }
+
+    switch (in->op)
+    {
+    case IR_MUL:
+        result(in, CG->mul_const(operand(left->id), right->imm));
+        break;
+    case IR_DIV:
+        result(in, CG->div_const(operand(left->id), right->imm));
+        break;
+    case IR_POW:
+        result(in, CG->pow_const(operand(left->id), right->imm));
+        break;
+    default:
+        result(in, CG->mod_const(operand(left->id), right->imm));
+        break;
+    }
+    return 1;
+}
+
+/**
+ * Lowers an instruction that is not a terminator.
+ *
+ * @param in The instruction
+ */
+static void lower_instr(IRinstr *in)
+{
+    int r;
+
+    if (in == Fused || in == Parity)
+    {
+        return; // Lowered with the branch
+    }
+    switch (in->op)
+    {
+    case IR_CONST:
+    case IR_PARAM:
+    case IR_PHI:
+        // Materialized where they are used, at the entry and by the predecessors
+        return;
+    case IR_NEG:
+        result(in, CG->neg(operand(in->args[0])));
+        return;
+    case IR_NOT:
+        result(in, CG->not(operand(in->args[0])));
+        return;
+    case IR_SEXT:
+        result(in, CG->sext(operand(in->args[0])));
+        return;
+    case IR_MUL:
+    case IR_DIV:
+    case IR_MOD:
+    case IR_POW:
+        if (lower_by_const(in))
+        {
+            return;
+        }
+        // fall through
+    case IR_ADD:
+    case IR_SUB:
+    case IR_EQ:
+    case IR_NE:
+    case IR_LT:
+    case IR_LE:
+    case IR_GT:
+    case IR_GE:
+    {
+        int left = operand(in->args[0]);
+        int right = operand(in->args[1]);
+
+        switch (in->op)
+        {
+        case IR_ADD:
+            r = CG->add(left, right);
+            break;
+        case IR_SUB:
+            r = CG->sub(left, right);
+            break;
+        case IR_MUL:
+            r = CG->mul(left, right);
+            break;
+        case IR_DIV:
+            r = CG->div(left, right);
+            break;
+        case IR_MOD:
+            r = CG->mod(left, right);
+            break;
+        case IR_POW:
+            r = CG->pow(left, right);
+            break;
+        default:
+            r = CG->cmp(left, right, Conds[in->op - IR_EQ]);
+            break;
+        }
+        result(in, r);
+        return;
+    }
+    case IR_LOAD:
+        result(in, CG->load_glob(in->sym));
+        return;
+    case IR_STORE:
+        r = CG->store_glob(operand(in->args[0]), in->sym);
+        CG->free_register(r);
+        return;
+    case IR_CALL:
+        for (int a = 0; a < in->nargs; a++)
+        {
+            r = operand(in->args[a]);
+            CG->load_arg(r, a);
+            CG->free_register(r);
+        }
+        CG->call(in->sym->name);
+        r = CG->alloc_register();
+        CG->store_result(r);
+        result(in, r);
+        return;
+    case IR_PRINT:
+        r = operand(in->args[0]);
+        CG->print(r);
+        CG->free_register(r);
+        return;
+    default:
+        fprintf(stderr, "Fatal Error: unknown IR operation %d\n", in->op);
+        exit(1);
+    }
+}
+
+/**
+ * Lowers a call in tail position of a function, the callee takes over its frame and returns
+ * to its caller. Arguments beyond the registers would live in the frame and a nested callee may
+ * read it, those keep the call.
+ *
+ * @param in The call
+ * @return 1 if it was lowered, the rest of the block is not needed
+ */
+static int lower_tail_call(IRinstr *in)
+{
+    if (Func->sym == NULL || in->nargs > 8 || is_nested_in(in->sym, Func->sym) || !ir_is_tail_call(in))
+    {
+        return 0;
+    }
+    for (int a = 0; a < in->nargs; a++)
+    {
+        int r = operand(in->args[a]);
+
+        CG->load_arg(r, a);
+        CG->free_register(r);
+    }
+    CG->tail_call(in->sym->name, FrameSize);
+    Stats.tailcalls++;
+    return 1;
+}
+
+/**
+ * Lowers a function, the top level ends falling through to the exit sequence.
+ *
+ * @param f The function
+ */
+static void lower_func(IRfunc *f)
+{
+    Func = f;
+    ir_cleanup(f);
+    ir_dominators(f);
+    ir_split_edges(f, early_copies);
+
+    Uses = (int *)zalloc(f->nvalues, sizeof(int));
+    InReg = (int *)zalloc(f->nvalues, sizeof(int));
+    Slot = (int *)zalloc(f->nvalues, sizeof(int));
+    Reg = (int *)zalloc(f->nvalues, sizeof(int));
+    Temp = (int *)zalloc(f->nvalues, sizeof(int));
+    for (int v = 0; v < f->nvalues; v++)
+    {
+        Reg[v] = NO_REG;
+    }
+    assign_storage();
+
+    for (int i = 0; i < f->norder; i++)
+    {
+        f->order[i]->label = CG->label();
+    }
+    CG->freeall_registers();
+    if (f->sym != NULL)
+    {
+        CG->genfunlabel(f->sym->name);
+    }
+    CG->preamble(FrameSize);
+
+    // Parameters leave their registers before anything else runs
+    for (IRinstr *in = f->blocks[0]->first; in != NULL; in = in->next)
+    {
+        if (in->op == IR_PARAM && Uses[in->id] > 0)
+        {
+            CG->store_param(in->imm, slot(Slot[in->id]));
+        }
+    }
+
+    for (int i = 0; i < f->norder; i++)
+    {
+        IRblock *b = f->order[i];
+
+        CG->genlabel(b->label);
+        fuse_compare(b);
+        for (IRinstr *in = b->first; in != NULL; in = in->next)
+        {
+            if (ir_is_terminator(in->op))
+            {
+                lower_terminator(in, i + 1 < f->norder ? f->order[i + 1] : NULL);
+            }
+            else if (in->op == IR_CALL && lower_tail_call(in))
+            {
+                break;
+            }
+            else
+            {
+                lower_instr(in);
+            }
+        }
+    }
+
+    free(Uses);
+    free(InReg);
+    free(Slot);
+    free(Reg);
+    free(Temp);
+}
+
+/**
+ * Lowers a function of the program. The top level gets the label its returns jump to, right
+ * before the exit sequence that follows it.
+ *
+ * @param f The function
+ */
+void ir_lower(IRfunc *f)
+{
+    if (f->sym != NULL)
+    {
+        lower_func(f);
+        return;
+    }
+    ExitLabel = CG->label();
+    lower_func(f);
+    CG->genlabel(ExitLabel);
+}
@@ -0,0 +1,117 @@
+/********************************************************************************
+ * File Name: src/ir/opt.c                                                      *
+ *                                                                              *
+ * Description: Optimizer, runs the passes over the IR of every function as     *
+ *              the optimization level asks and reports what they changed.      *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ ********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+/**
+ * Counts the instructions of a function.
+ *
+ * @param f The function
+ * @return Number of instructions
+ */
+static int count_instrs(IRfunc *f)
+{
+    int n = 0;
+
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        for (IRinstr *in = f->blocks[i]->first; in != NULL; in = in->next)
+        {
+            n++;
+        }
+    }
+    return n;
+}
+
+/**
+ * Runs the scalar passes over a function.
+ *
+ * @param f The function
+ */
+static void scalar_passes(IRfunc *f)
+{
+    int instrs = count_instrs(f), blocks = f->nblocks;
+
+    ir_sccp(f);
+    ir_verify(f);
+    ir_dce(f);
+    ir_verify(f);
+    Stats.instrs += instrs - count_instrs(f);
+    Stats.blocks += blocks - f->nblocks;
+
+    ir_gvn(f);
+    ir_verify(f);
+}
+
+/**
+ * Optimizes every function of a program. -O1 runs the scalar passes, -O2 adds the loop ones
+ * and -O0 leaves the IR as it was built.
+ *
+ * @param p The program
+ */
+void ir_optimize(IRprogram *p)
+{
+    if (OptLevel < 1)
+    {
+        return;
+    }
+    ir_global_constants(p);
+
+    // Recursion in tail position becomes a loop the other passes can work on
+    for (int i = 0; i < p->nfuncs; i++)
+    {
+        ir_tail_recursion(p->funcs[i]);
+        ir_verify(p->funcs[i]);
+        scalar_passes(p->funcs[i]);
+    }
+    if (OptLevel < 2)
+    {
+        return;
+    }
+
+    // Inlined bodies meet the constants and values of their callers
+    ir_inline(p);
+    for (int i = 0; i < p->nfuncs; i++)
+    {
+        scalar_passes(p->funcs[i]);
+    }
+
+    // Loop optimizations, they need to know which calls can move
+    ir_find_pure(p);
+    for (int i = 0; i < p->nfuncs; i++)
+    {
+        ir_licm(p->funcs[i]);
+        ir_verify(p->funcs[i]);
+    }
+}
+
+/**
+ * Prints what the optimizer changed.
+ */
+void opt_report(void)
+{
+    fprintf(stderr, "%-40s %10d\n", "loads of constant globals", Stats.globals);
+    fprintf(stderr, "%-40s %10d\n", "constants propagated", Stats.constants);
+    fprintf(stderr, "%-40s %10d\n", "branches folded", Stats.branches);
+    fprintf(stderr, "%-40s %10d\n", "instructions removed", Stats.instrs);
+    fprintf(stderr, "%-40s %10d\n", "blocks removed", Stats.blocks);
+    fprintf(stderr, "%-40s %10d\n", "redundant values removed", Stats.redundant);
+    fprintf(stderr, "%-40s %10d\n", "loads reused", Stats.loads);
+    fprintf(stderr, "%-40s %10d\n", "loop-invariant values hoisted", Stats.hoisted);
+    fprintf(stderr, "%-40s %10d\n", "calls inlined", Stats.inlined);
+    fprintf(stderr, "%-40s %10d\n", "tail recursions turned into loops", Stats.loops);
+    fprintf(stderr, "%-40s %10d\n", "tail calls", Stats.tailcalls);
+    fprintf(stderr, "%-40s %10d\n", "unreachable functions dropped", Stats.dropped);
+}
@@ -0,0 +1,635 @@
+/********************************************************************************
+ * File Name: src/ir/sccp.c                                                     *
+ *                                                                              *
+ * Description: Sparse Conditional Constant Propagation (Wegman and Zadeck),    *
+ *              finds the values that are constant on every path that can run   *
+ *              and the branches that always go the same way. Also finds the    *
+ *              globals that only ever hold one constant.                       *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ ********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+// Lattice of a value: not known yet, one constant, or anything
+enum
+{
+    TOP,
+    CONST,
+    BOTTOM
+};
+
+// What is known about a global
+typedef struct Global
+{
+    Symbol *sym; // The global, NULL for an empty slot
+    int state;   // TOP until a store is seen
+    int value;   // The constant stored, when CONST
+    int ready;   // Stored by the entry block of the top level before any call
+    int stored;  // Stored by the part of that block already scanned
+} Global;
+
+static Global *Globals; // Open addressing table of the globals stored to
+static int MaxGlobals;  // Capacity of the table, a power of two
+
+static int *State;        // Lattice of every value
+static int *Consts;       // Constant of the values in CONST
+static char *Reached;     // Blocks that can run
+static char *Taken;       // Edges that can run, the ones of block b start at EdgeStart[b]
+static int *EdgeStart;    // Index in Taken of the first edge of every block
+static int *UseStart;     // Users of value v are Users[UseStart[v]] .. Users[UseStart[v + 1] - 1]
+static IRinstr **Users;   // Instructions using each value
+static IRinstr **SSAWork; // Values whose lattice went down
+static int NumSSAWork;
+static IRblock **CFGWork; // Blocks reached through a new edge
+static int NumCFGWork;
+
+/**
+ * Allocates zeroed memory or stops the compiler.
+ *
+ * @param n Number of entries
+ * @param size Size of an entry
+ * @return The memory
+ */
+static void *zalloc(int n, size_t size)
+{
+    void *p = calloc(n + 1, size);
+
+    if (p == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+/**
+ * Finds the slot of a global in the table.
+ *
+ * @param sym The global
+ * @return Its slot, empty if the global was not seen yet
+ */
+static Global *find_global(Symbol *sym)
+{
+    unsigned h = (unsigned)((uintptr_t)sym >> 4) & (MaxGlobals - 1);
+
+    while (Globals[h].sym != NULL && Globals[h].sym != sym)
+    {
+        h = (h + 1) & (MaxGlobals - 1);
+    }
+    return &Globals[h];
+}
+
+/**
+ * Records that a global may hold some value.
+ *
+ * @param sym The global
+ * @param known 1 if the value is the constant val
+ * @param val The constant
+ */
+static void store_global(Symbol *sym, int known, int val)
+{
+    Global *g = find_global(sym);
+
+    if (g->sym == NULL)
+    {
+        g->sym = sym;
+        g->state = known ? CONST : BOTTOM;
+        g->value = val;
+    }
+    else if (!known || g->state != CONST || g->value != val)
+    {
+        g->state = BOTTOM;
+    }
+}
+
+/**
+ * Records the globals assigned by a function left to the direct code generator.
+ *
+ * @param n Node of its body
+ */
+static void direct_stores(ASTnode *n)
+{
+    if (n == NULL)
+    {
+        return;
+    }
+    if (n->type == A_SEQ)
+    {
+        for (int i = 0; i < AST_VALUE(n).list->count; i++)
+        {
+            direct_stores(AST_NODE(AST_VALUE(n).list->item[i]));
+        }
+        return;
+    }
+    if (n->type >= A_ASSIGN && n->type <= A_ASOR && AST_LEFT(n)->type == A_IDENT &&
+        AST_VALUE(AST_LEFT(n)).symbol->sclass == C_GLOBAL)
+    {
+        store_global(AST_VALUE(AST_LEFT(n)).symbol, 0, 0);
+    }
+    direct_stores(AST_LEFT(n));
+    direct_stores(AST_MID(n));
+    direct_stores(AST_RIGHT(n));
+}
+
+/**
+ * Checks if a load of a global always reads one constant.
+ *
+ * @param g Slot of the global
+ * @param entry 1 for a load in the entry block of the top level
+ * @return 1 if the load can be replaced by g->value
+ */
+static int known_global(Global *g, int entry)
+{
+    if (g->state != CONST || g->value == 0)
+    {
+        return g->state == CONST;
+    }
+    return entry ? g->stored : g->ready;
+}
+
+/**
+ * Replaces the loads of the globals that always hold the same constant. Memory starts at 0, so
+ * a global only ever set to 0 is 0 everywhere. Any other constant must be stored by the entry
+ * block of the top level before its first call, then every function sees it.
+ *
+ * @param p The program
+ */
+void ir_global_constants(IRprogram *p)
+{
+    IRblock *entry = p->funcs[0]->blocks[0];
+    int count = 0;
+    IRinstr *in;
+
+    for (int i = 0; i < p->nfuncs; i++)
+    {
+        for (int b = 0; b < p->funcs[i]->nblocks; b++)
+        {
+            for (in = p->funcs[i]->blocks[b]->first; in != NULL; in = in->next)
+            {
+                count += in->op == IR_STORE || in->op == IR_LOAD;
+            }
+        }
+    }
+    MaxGlobals = 16;
+    while (MaxGlobals < count * 2)
+    {
+        MaxGlobals *= 2;
+    }
+    Globals = (Global *)zalloc(MaxGlobals, sizeof(Global));
+
+    // Every value stored, the direct code generator may store anything
+    for (int i = 0; i < p->nfuncs; i++)
+    {
+        IRfunc *f = p->funcs[i];
+
+        for (int b = 0; b < f->nblocks; b++)
+        {
+            for (in = f->blocks[b]->first; in != NULL; in = in->next)
+            {
+                if (in->op == IR_STORE)
+                {
+                    IRinstr *v = f->values[in->args[0]];
+
+                    store_global(in->sym, v->op == IR_CONST, v->imm);
+                }
+            }
+        }
+    }
+    for (int i = 0; i < p->ndirect; i++)
+    {
+        direct_stores(AST_LEFT(p->direct[i]));
+    }
+    for (in = entry->first; in != NULL && in->op != IR_CALL; in = in->next)
+    {
+        if (in->op == IR_STORE)
+        {
+            find_global(in->sym)->ready = 1;
+        }
+    }
+
+    for (int i = 0; i < p->nfuncs; i++)
+    {
+        IRfunc *f = p->funcs[i];
+
+        for (int b = 0; b < f->nblocks; b++)
+        {
+            for (in = f->blocks[b]->first; in != NULL; in = in->next)
+            {
+                Global *g;
+
+                if (in->op == IR_STORE && f->blocks[b] == entry)
+                {
+                    find_global(in->sym)->stored = 1;
+                }
+                if (in->op != IR_LOAD || in->sym->sclass != C_GLOBAL)
+                {
+                    continue;
+                }
+                g = find_global(in->sym);
+                if (g->sym == NULL)
+                {
+                    // Never stored, it keeps its initial 0
+                    g->sym = in->sym;
+                    g->state = CONST;
+                }
+                if (known_global(g, f->blocks[b] == entry))
+                {
+                    in->op = IR_CONST;
+                    in->imm = g->value;
+                    in->sym = NULL;
+                    Stats.globals++;
+                }
+            }
+        }
+    }
+    free(Globals);
+    Globals = NULL;
+}
+
+/**
+ * Lowers the lattice of a value and queues its users.
+ *
+ * @param in The instruction defining it
+ * @param state New state
+ * @param val The constant, when CONST
+ */
+static void lower_value(IRinstr *in, int state, long long val)
+{
+    // Constants must fit an immediate, like the ones folded in the AST
+    if (state == CONST && (val < INT32_MIN || val > INT32_MAX))
+    {
+        state = BOTTOM;
+    }
+    if (state == State[in->id] && (state != CONST || val == Consts[in->id]))
+    {
+        return;
+    }
+    // A second constant means the value changes
+    if (state == CONST && State[in->id] == CONST)
+    {
+        state = BOTTOM;
+    }
+    State[in->id] = state;
+    Consts[in->id] = (int)val;
+    SSAWork[NumSSAWork++] = in;
+}
+
+/**
+ * Marks an edge as able to run.
+ *
+ * @param b Source block
+ * @param k Index of the edge among its successors
+ */
+static void take_edge(IRblock *b, int k)
+{
+    if (Taken[EdgeStart[b->id] + k])
+    {
+        return;
+    }
+    Taken[EdgeStart[b->id] + k] = 1;
+    CFGWork[NumCFGWork++] = b->succ[k];
+}
+
+/**
+ * Checks if some edge from a block to another can run.
+ *
+ * @param from Source block
+ * @param to Destination block
+ * @return 1 if it can
+ */
+static int edge_taken(IRblock *from, IRblock *to)
+{
+    for (int k = 0; k < from->nsucc; k++)
+    {
+        if (from->succ[k] == to && Taken[EdgeStart[from->id] + k])
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Finds the edge a switch takes when its value is a known constant.
+ *
+ * @param in The switch
+ * @return Index of the edge among the successors
+ */
+static int switch_target(IRinstr *in)
+{
+    int k = 0;
+
+    while (k + 1 < in->nargs && Consts[in->args[k + 1]] != Consts[in->args[0]])
+    {
+        k++;
+    }
+    return k;
+}
+
+/**
+ * Computes the lattice of an instruction from the ones of its arguments.
+ *
+ * @param in The instruction
+ */
+static void visit(IRinstr *in)
+{
+    static const ASTnodeType binop[] = {
+        [IR_ADD] = A_ADD, [IR_SUB] = A_SUB, [IR_MUL] = A_MUL, [IR_DIV] = A_DIV, [IR_MOD] = A_MOD,
+        [IR_POW] = A_POW, [IR_EQ] = A_EQ, [IR_NE] = A_NEQ, [IR_LT] = A_LT, [IR_LE] = A_LE,
+        [IR_GT] = A_GT, [IR_GE] = A_GE};
+    IRblock *b = in->block;
+    int ok, state = CONST;
+    long long val = 0;
+
+    switch (in->op)
+    {
+    case IR_CONST:
+        lower_value(in, CONST, in->imm);
+        return;
+    case IR_PHI:
+        // Meet of the arguments coming through edges that can run
+        state = TOP;
+        for (int a = 0; a < in->nargs; a++)
+        {
+            int v = in->args[a];
+
+            if (!edge_taken(b->preds[a], b) || State[v] == TOP)
+            {
+                continue;
+            }
+            if (State[v] == BOTTOM || (state == CONST && Consts[v] != val))
+            {
+                state = BOTTOM;
+                break;
+            }
+            state = CONST;
+            val = Consts[v];
+        }
+        if (state != TOP)
+        {
+            lower_value(in, state, val);
+        }
+        return;
+    case IR_JMP:
+        take_edge(b, 0);
+        return;
+    case IR_BR:
+        if (State[in->args[0]] == CONST)
+        {
+            take_edge(b, Consts[in->args[0]] ? 0 : 1);
+        }
+        else if (State[in->args[0]] == BOTTOM)
+        {
+            take_edge(b, 0);
+            take_edge(b, 1);
+        }
+        return;
+    case IR_SWITCH:
+        if (State[in->args[0]] == CONST)
+        {
+            take_edge(b, switch_target(in));
+        }
+        else if (State[in->args[0]] == BOTTOM)
+        {
+            for (int k = 0; k < b->nsucc; k++)
+            {
+                take_edge(b, k);
+            }
+        }
+        return;
+    case IR_PARAM:
+    case IR_LOAD:
+    case IR_CALL:
+        lower_value(in, BOTTOM, 0);
+        return;
+    case IR_STORE:
+    case IR_PRINT:
+    case IR_RET:
+        return;
+    default:
+        break;
+    }
+
+    // Operations on values, anything unknown keeps the result unknown
+    for (int a = 0; a < in->nargs; a++)
+    {
+        if (State[in->args[a]] == TOP)
+        {
+            return;
+        }
+        if (State[in->args[a]] == BOTTOM)
+        {
+            state = BOTTOM;
+        }
+    }
+    if (state == BOTTOM)
+    {
+        lower_value(in, BOTTOM, 0);
+        return;
+    }
+
+    switch (in->op)
+    {
+    case IR_NEG:
+        val = -(long long)Consts[in->args[0]];
+        break;
+    case IR_SEXT:
+        val = Consts[in->args[0]];
+        break;
+    case IR_NOT:
+        val = !Consts[in->args[0]];
+        break;
+    default:
+        val = eval_binary(binop[in->op], Consts[in->args[0]], Consts[in->args[1]], &ok);
+        if (!ok)
+        {
+            state = BOTTOM;
+        }
+        break;
+    }
+    lower_value(in, state, val);
+}
+
+/**
+ * Runs the analysis until nothing changes.
+ *
+ * @param f The function
+ */
+static void propagate(IRfunc *f)
+{
+    CFGWork[NumCFGWork++] = f->blocks[0];
+
+    while (NumCFGWork > 0 || NumSSAWork > 0)
+    {
+        while (NumCFGWork > 0)
+        {
+            IRblock *b = CFGWork[--NumCFGWork];
+
+            // A new edge only changes the phis, a new block runs everything once
+            for (IRinstr *in = b->first; in != NULL; in = in->next)
+            {
+                if (in->op != IR_PHI && Reached[b->id])
+                {
+                    break;
+                }
+                visit(in);
+            }
+            Reached[b->id] = 1;
+        }
+        while (NumSSAWork > 0)
+        {
+            IRinstr *def = SSAWork[--NumSSAWork];
+
+            for (int u = UseStart[def->id]; u < UseStart[def->id + 1]; u++)
+            {
+                if (Reached[Users[u]->block->id])
+                {
+                    visit(Users[u]);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Rewrites the values found constant and the branches that always go one way.
+ *
+ * @param f The function
+ */
+static void rewrite(IRfunc *f)
+{
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        IRblock *b = f->blocks[i];
+        IRinstr *in, *next;
+
+        if (!Reached[b->id])
+        {
+            continue;
+        }
+        for (in = b->first; in != NULL; in = next)
+        {
+            next = in->next;
+            if (in->op == IR_CONST || State[in->id] != CONST)
+            {
+                continue;
+            }
+            Stats.constants++;
+            if (in->op == IR_PHI)
+            {
+                // Constants cannot sit among the phis
+                ir_replace(f, in->id, ir_const(f, Consts[in->id]));
+                ir_remove(f, in);
+                continue;
+            }
+            in->op = IR_CONST;
+            in->imm = Consts[in->id];
+            in->nargs = 0;
+        }
+
+        in = b->last;
+        if (in->op == IR_BR && State[in->args[0]] == CONST)
+        {
+            ir_remove_edge(b, Consts[in->args[0]] ? 1 : 0);
+            in->op = IR_JMP;
+            in->nargs = 0;
+            Stats.branches++;
+        }
+        else if (in->op == IR_SWITCH && State[in->args[0]] == CONST)
+        {
+            int keep = switch_target(in);
+
+            for (int k = b->nsucc - 1; k >= 0; k--)
+            {
+                if (k != keep)
+                {
+                    ir_remove_edge(b, k);
+                }
+            }
+            in->op = IR_JMP;
+            in->nargs = 0;
+            Stats.branches++;
+        }
+    }
+}
+
+/**
+ * Propagates constants through a function, folds its branches and drops the code that cannot
+ * run any more.
+ *
+ * @param f The function
+ */
+void ir_sccp(IRfunc *f)
+{
+    int n = f->nvalues, uses = 0, edges = 0;
+
+    State = (int *)zalloc(n, sizeof(int));
+    Consts = (int *)zalloc(n, sizeof(int));
+    Reached = (char *)zalloc(f->nblocks, sizeof(char));
+    EdgeStart = (int *)zalloc(f->nblocks, sizeof(int));
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        EdgeStart[i] = edges;
+        edges += f->blocks[i]->nsucc;
+    }
+    Taken = (char *)zalloc(edges, sizeof(char));
+    UseStart = (int *)zalloc(n + 1, sizeof(int));
+    SSAWork = (IRinstr **)zalloc(n * 2, sizeof(IRinstr *));
+    CFGWork = (IRblock **)zalloc(edges + 1, sizeof(IRblock *));
+
+    // Users of every value, counted first and then placed
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        for (IRinstr *in = f->blocks[i]->first; in != NULL; in = in->next)
+        {
+            for (int a = 0; a < in->nargs; a++)
+            {
+                UseStart[in->args[a] + 1]++;
+                uses++;
+            }
+        }
+    }
+    for (int v = 0; v < n; v++)
+    {
+        UseStart[v + 1] += UseStart[v];
+    }
+    Users = (IRinstr **)zalloc(uses, sizeof(IRinstr *));
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        for (IRinstr *in = f->blocks[i]->first; in != NULL; in = in->next)
+        {
+            for (int a = 0; a < in->nargs; a++)
+            {
+                Users[UseStart[in->args[a]]++] = in;
+            }
+        }
+    }
+    for (int v = n; v > 0; v--)
+    {
+        UseStart[v] = UseStart[v - 1];
+    }
+    UseStart[0] = 0;
+
+    propagate(f);
+    rewrite(f);
+    ir_cleanup(f);
+
+    free(State);
+    free(Consts);
+    free(Reached);
+    free(Taken);
+    free(EdgeStart);
+    free(UseStart);
+    free(Users);
+    free(SSAWork);
+    free(CFGWork);
+}
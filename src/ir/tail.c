@@ -0,0 +1,142 @@
+/********************************************************************************
+ * File Name: src/ir/tail.c                                                     *
+ *                                                                              *
+ * Description: Tail Recursion Elimination, turns the calls of a function to    *
+ *              itself whose value it returns at once into jumps back to its    *
+ *              start. The parameters become phis that take the arguments of    *
+ *              every such call.                                                *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ ********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+/**
+ * Finds the calls of a function to itself in tail position.
+ *
+ * @param f The function
+ * @param calls Where the calls go, one per block at most
+ * @return Number of calls found
+ */
+static int find_calls(IRfunc *f, IRinstr **calls)
+{
+    int n = 0;
+
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        IRinstr *last = f->blocks[i]->last;
+        IRinstr *in = last != NULL ? last->prev : NULL;
+
+        // Arguments beyond the registers never reach the parameters
+        if (in != NULL && in->op == IR_CALL && in->sym == f->sym && in->nargs == f->sym->numParams &&
+            ir_is_tail_call(in))
+        {
+            calls[n++] = in;
+        }
+    }
+    return n;
+}
+
+/**
+ * Turns the self-recursive tail calls of a function into a loop. The entry block keeps the
+ * parameters and jumps to a header holding the rest of the body, the calls jump back to it.
+ *
+ * @param f The function
+ */
+void ir_tail_recursion(IRfunc *f)
+{
+    IRinstr **calls, **phis;
+    IRblock *entry = f->blocks[0], *header;
+    int n, nparams;
+
+    if (f->sym == NULL || (nparams = f->sym->numParams) == 0)
+    {
+        return; // Without parameters the jump back is left to the backend
+    }
+    calls = (IRinstr **)malloc((f->nblocks + 1) * sizeof(IRinstr *));
+    phis = (IRinstr **)malloc((nparams + 1) * sizeof(IRinstr *));
+    if (calls == NULL || phis == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+    ir_rewrite(f);
+    if ((n = find_calls(f, calls)) == 0)
+    {
+        free(calls);
+        free(phis);
+        return;
+    }
+
+    // Only the parameters stay in the entry block, the code reading them goes to the header
+    for (IRinstr *in = entry->first, *next; in != NULL; in = next)
+    {
+        next = in->next;
+        if (in->op == IR_PARAM)
+        {
+            phis[in->imm] = in;
+            ir_remove(f, in);
+            f->values[in->id] = in;
+        }
+    }
+    for (int p = nparams - 1; p >= 0; p--)
+    {
+        ir_insert_before(entry->first, phis[p]);
+    }
+    header = ir_split_block(f, phis[nparams - 1]);
+    ir_append(entry, ir_instr(f, IR_JMP, 0));
+    ir_edge(entry, header);
+
+    // Every use of a parameter reads the phi, which takes the parameter on the entry edge
+    for (int p = 0; p < nparams; p++)
+    {
+        IRinstr *phi = ir_instr(f, IR_PHI, 0);
+
+        for (int i = 0; i < f->nblocks; i++)
+        {
+            for (IRinstr *in = f->blocks[i]->first; in != NULL; in = in->next)
+            {
+                for (int a = 0; a < in->nargs; a++)
+                {
+                    if (in->args[a] == phis[p]->id)
+                    {
+                        in->args[a] = phi->id;
+                    }
+                }
+            }
+        }
+        ir_add_arg(phi, phis[p]->id);
+        ir_insert_before(header->first, phi);
+        phis[p] = phi;
+    }
+
+    // The calls jump back with their arguments
+    for (int c = 0; c < n; c++)
+    {
+        IRinstr *call = calls[c], *jump = call->next;
+        IRblock *b = call->block;
+
+        if (jump->op == IR_JMP)
+        {
+            ir_remove_edge(b, 0);
+        }
+        ir_remove(f, jump);
+        ir_remove(f, call);
+        ir_append(b, ir_instr(f, IR_JMP, 0));
+        ir_edge(b, header);
+        for (int p = 0; p < nparams; p++)
+        {
+            ir_add_arg(phis[p], call->args[p]);
+        }
+        Stats.loops++;
+    }
+    free(calls);
+    free(phis);
+    ir_cleanup(f);
+}
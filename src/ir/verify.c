@@ -0,0 +1,183 @@
+/********************************************************************************
+ * File Name: src/ir/verify.c                                                   *
+ *                                                                              *
+ * Description: IR Verifier, checks the shape of the CFG and the SSA property   *
+ *              (every use is dominated by its definition) after the IR is      *
+ *              built and after every pass that rewrites it.                    *
+ * Author: Alejandro Diez Bermejo                                               *
+ * Date: 2026-10-17                                                             *
+ * Version: 0.0.0                                                               *
+ ********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "defs.h"
+#include "data.h"
+#include "decl.h"
+
+/**
+ * Reports a broken invariant and stops.
+ *
+ * @param f The function
+ * @param b Block where it was found
+ * @param what Description of the problem
+ */
+static void fail(IRfunc *f, IRblock *b, char *what)
+{
+    fprintf(stderr, "Fatal Error: invalid IR in %s, block B%d: %s\n", f->sym ? f->sym->name : "top level", b->id, what);
+    ir_dump(f, stderr);
+    exit(1);
+}
+
+/**
+ * Checks the edges of a block against its terminator and its successors.
+ *
+ * @param f The function
+ * @param b The block
+ */
+static void verify_edges(IRfunc *f, IRblock *b)
+{
+    int want = b->last->op == IR_JMP ? 1 : b->last->op == IR_BR ? 2 : 0;
+
+    // A switch has an edge per case and one for the default
+    if (b->last->op == IR_SWITCH)
+    {
+        want = b->last->nargs;
+    }
+
+    if (b->nsucc != want)
+    {
+        fail(f, b, "successors do not match the terminator");
+    }
+    for (int s = 0; s < b->nsucc; s++)
+    {
+        int found = 0;
+
+        for (int p = 0; p < b->succ[s]->npreds; p++)
+        {
+            found |= b->succ[s]->preds[p] == b;
+        }
+        if (!found)
+        {
+            fail(f, b, "edge missing from the predecessors of its successor");
+        }
+    }
+    for (int p = 0; p < b->npreds; p++)
+    {
+        IRblock *pred = b->preds[p];
+        int found = 0;
+
+        for (int s = 0; s < pred->nsucc; s++)
+        {
+            found |= pred->succ[s] == b;
+        }
+        if (!found)
+        {
+            fail(f, b, "predecessor without an edge to the block");
+        }
+    }
+}
+
+/**
+ * Verifies a function, stops the compiler with a dump if it is broken.
+ *
+ * @param f The function
+ */
+void ir_verify(IRfunc *f)
+{
+    int *pos = (int *)malloc(f->nvalues * sizeof(int) + 1);
+
+    if (pos == NULL)
+    {
+        fprintf(stderr, "Fatal Error: out of memory\n");
+        exit(1);
+    }
+    ir_dominators(f);
+
+    // Position of every instruction in its block
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        int n = 0;
+
+        for (IRinstr *in = f->blocks[i]->first; in != NULL; in = in->next)
+        {
+            pos[in->id] = n++;
+        }
+    }
+
+    for (int i = 0; i < f->nblocks; i++)
+    {
+        IRblock *b = f->blocks[i];
+        int phis = 1;
+
+        if (b->id != i)
+        {
+            fail(f, b, "block numbered out of place");
+        }
+        if (b->rpo == -1)
+        {
+            fail(f, b, "unreachable block");
+        }
+        if (b->last == NULL || !ir_is_terminator(b->last->op))
+        {
+            fail(f, b, "block without terminator");
+        }
+        verify_edges(f, b);
+
+        for (IRinstr *in = b->first; in != NULL; in = in->next)
+        {
+            if (in->block != b || f->values[in->id] != in)
+            {
+                fail(f, b, "instruction not linked to its block");
+            }
+            if (ir_is_terminator(in->op) && in != b->last)
+            {
+                fail(f, b, "terminator in the middle of the block");
+            }
+            if (in->op == IR_PHI)
+            {
+                if (!phis)
+                {
+                    fail(f, b, "phi after other instructions");
+                }
+                if (in->nargs != b->npreds)
+                {
+                    fail(f, b, "phi arguments do not match the predecessors");
+                }
+            }
+            else
+            {
+                phis = 0;
+            }
+
+            // Every argument must be defined where it is used
+            for (int a = 0; a < in->nargs; a++)
+            {
+                int v = in->args[a];
+                IRinstr *def = v >= 0 && v < f->nvalues ? f->values[v] : NULL;
+
+                if (def == NULL || f->forward[v] != v)
+                {
+                    fail(f, b, "use of an undefined value");
+                }
+                if (in->op == IR_PHI)
+                {
+                    if (!ir_dominates(def->block, b->preds[a]))
+                    {
+                        fail(f, b, "phi argument does not dominate its predecessor");
+                    }
+                }
+                else if (def->block == b ? pos[def->id] >= pos[in->id] : !ir_dominates(def->block, b))
+                {
+                    fail(f, b, "use not dominated by its definition");
+                }
+                if (in->op == IR_SWITCH && a > 0 && def->op != IR_CONST)
+                {
+                    fail(f, b, "switch case that is not a constant");
+                }
+            }
+        }
+    }
+    free(pos);
+}
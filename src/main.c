@@ -34,8 +34,15 @@
 void usage(char *prog_name)
 {
     fprintf(stderr, "Usage: %s [options] <file>\n", prog_name);
+    fprintf(stderr, "       (use '-' as <file> to read the program from stdin)\n");
     fprintf(stderr, "Options:\n");
     fprintf(stderr, "  -o <file>    Specify output file name (default: out.s)\n");
+    fprintf(stderr, "  -O<level>    Optimization level, -O0 (default) skips the IR, -O1 and -O2 use it\n");
+    fprintf(stderr, "  --emit=ir    Write the IR instead of assembly (default file: out.ir)\n");
+    fprintf(stderr, "  --mem-report Print the memory used by every compiler phase\n");
+    fprintf(stderr, "  --opt-report Print what the optimizer removed or rewrote\n");
+    fprintf(stderr, "  --inline-threshold=<n>\n");
+    fprintf(stderr, "               Largest function inlined at every call with -O2 (default: 30)\n");
     fprintf(stderr, "  -v           Show compiler version\n");
     fprintf(stderr, "  -h           Show this help message\n");
     exit(1);
@@ -62,7 +69,7 @@ void parse_args(int argc, char *argv[])
     // Check for flags
     for (int i = 1; i < argc; i++)
     {
-        if (argv[i][0] == '-')
+        if (argv[i][0] == '-' && argv[i][1] != '\0')
         {
             if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0)
             {
@@ -72,6 +79,26 @@ void parse_args(int argc, char *argv[])
             {
                 version();
             }
+            else if (argv[i][1] == 'O' && argv[i][2] >= '0' && argv[i][2] <= '2' && argv[i][3] == '\0')
+            {
+                OptLevel = argv[i][2] - '0';
+            }
+            else if (strcmp(argv[i], "--emit=ir") == 0 || strcmp(argv[i], "--emit=asm") == 0)
+            {
+                EmitIR = argv[i][7] == 'i';
+            }
+            else if (strcmp(argv[i], "--mem-report") == 0)
+            {
+                MemReport = 1;
+            }
+            else if (strcmp(argv[i], "--opt-report") == 0)
+            {
+                OptReport = 1;
+            }
+            else if (strncmp(argv[i], "--inline-threshold=", 19) == 0 && argv[i][19] != '\0')
+            {
+                InlineThreshold = atoi(argv[i] + 19);
+            }
             else if (strcmp(argv[i], "-o") == 0)
             {
                 if (i + 1 < argc)
@@ -112,7 +139,7 @@ void parse_args(int argc, char *argv[])
     // Set default output if not provided
     if (OutputFilename == NULL)
     {
-        OutputFilename = "out.s";
+        OutputFilename = EmitIR ? "out.ir" : "out.s";
     }
 }
 
@@ -128,26 +155,24 @@ int main(int argc, char *argv[])
     // Parse command line arguments
     parse_args(argc, argv);
 
-    // Open input file
-    if ((InputFile = fopen(InputFilename, "r")) == NULL)
-    {
-        fprintf(stderr, "Error: cannot open input file '%s': %s\n", InputFilename, strerror(errno));
-        exit(1);
-    }
+    // Load input file
+    open_input(InputFilename);
 
     // Create output file
     if ((OutFile = fopen(OutputFilename, "w")) == NULL)
     {
         fprintf(stderr, "Error: cannot create output file '%s': %s\n", OutputFilename, strerror(errno));
-        fclose(InputFile); // Clean up input file
+        close_input(); // Clean up input buffer
         exit(1);
     }
 
-    // Initialize scanner
-    scan(&CurrentToken);
+    // Scan the whole input into the token stream
+    tokenize();
+    advance();
 
     // Parse the program
     ASTnode *tree = compound_statement();
+    free_tokens();
 
     // Generate Code
     if (tree != NULL)
@@ -155,11 +180,21 @@ int main(int argc, char *argv[])
         gencode(tree);
     }
 
-    // Cleanup and exit
-    if (InputFile != NULL)
+    // Release the remaining phases
+    free_ast();
+    arena_free(&GenArena);
+    arena_free(&SymArena);
+    if (MemReport)
     {
-        fclose(InputFile);
+        mem_report();
     }
+    if (OptReport)
+    {
+        opt_report();
+    }
+
+    // Cleanup and exit
+    close_input();
     if (OutFile != NULL)
     {
         fclose(OutFile);
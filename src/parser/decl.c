@@ -39,7 +39,7 @@ static PType parse_type(void)
         fprintf(stderr, "Syntax Error: expected type at %d:%d\n", Line, Column);
         exit(1);
     }
-    scan(&CurrentToken);
+    advance();
     return type;
 }
 
@@ -52,7 +52,7 @@ ASTnode *var_declaration(void)
 {
     ASTnode *left, *right;
     Symbol *sym;
-    char name[MAX_LEN];
+    char *name;
     PType type;
 
     match(T_VAR);
@@ -63,8 +63,8 @@ ASTnode *var_declaration(void)
         fprintf(stderr, "Syntax Error: expected identifier after 'var' at %d:%d\n", Line, Column);
         exit(1);
     }
-    strncpy(name, CurrentToken.value.string, MAX_LEN);
-    scan(&CurrentToken);
+    name = CurrentToken.value.string;
+    advance();
 
     // Get type
     match(T_COLON);
@@ -81,7 +81,7 @@ ASTnode *var_declaration(void)
     // Check for initilization
     if (CurrentToken.type == T_ASSIGN)
     {
-        scan(&CurrentToken);
+        advance();
 
         right = expression();
         left = mkastleaf(A_IDENT, type, (Value){.symbol = sym});
@@ -98,10 +98,11 @@ ASTnode *var_declaration(void)
  */
 ASTnode *const_declaration(void)
 {
-    ASTnode *left, *right;
+    ASTnode *left, *right, *assign;
     Symbol *sym;
-    char name[MAX_LEN];
+    char *name;
     PType type;
+    int prevOffset;
 
     match(T_CONST);
 
@@ -111,14 +112,15 @@ ASTnode *const_declaration(void)
         fprintf(stderr, "Syntax Error: expected identifier after 'const' at %d:%d\n", Line, Column);
         exit(1);
     }
-    strncpy(name, CurrentToken.value.string, MAX_LEN);
-    scan(&CurrentToken);
+    name = CurrentToken.value.string;
+    advance();
 
     // Get type
     match(T_COLON);
     type = parse_type();
 
     // Create a new symbol in current scope
+    prevOffset = LocalOffset;
     sym = addsymbol(name, S_CONSTANT, type);
     if (sym == NULL)
     {
@@ -131,23 +133,43 @@ ASTnode *const_declaration(void)
 
     right = expression();
     left = mkastleaf(A_IDENT, type, (Value){.symbol = sym});
+    assign = mkastbinary(A_ASSIGN, left, right, NO_VALUE);
 
-    return mkastbinary(A_ASSIGN, left, right, NO_VALUE);
+    // A literal initializer turns every use into an immediate, the storage is given back
+    if (right->type == A_INTLIT || right->type == A_TRUE || right->type == A_FALSE)
+    {
+        sym->value = right->type == A_INTLIT ? AST_VALUE(right).integer : right->type == A_TRUE;
+        if (sym->sclass == C_LOCAL && LocalOffset == sym->offset)
+        {
+            LocalOffset = prevOffset;
+        }
+        sym->sclass = C_IMMEDIATE;
+        sym->offset = 0;
+        return NULL;
+    }
+    return assign;
 }
 
 /**
- * Parses a function definition.
+ * Parses a function definition, optionally preceded by an inlining hint.
  *
  * @return The AST node
  */
 ASTnode *function_declaration(void)
 {
-    ASTnode *body = NULL;
+    ASTnode *body;
     Symbol *sym, *prevFunc;
-    int prevOffset;
-    char name[MAX_LEN];
+    int prevOffset, mark;
+    char *name;
     PType ptype;
+    Inline inlining = INL_AUTO;
 
+    // Get inlining hint
+    if (CurrentToken.type == T_INLINE || CurrentToken.type == T_NOINLINE)
+    {
+        inlining = CurrentToken.type == T_INLINE ? INL_ALWAYS : INL_NEVER;
+        advance();
+    }
     match(T_FUN);
 
     // Get identifier
@@ -156,8 +178,8 @@ ASTnode *function_declaration(void)
         fprintf(stderr, "Syntax Error: expected function name at %d:%d\n", Line, Column);
         exit(1);
     }
-    strncpy(name, CurrentToken.value.string, MAX_LEN);
-    scan(&CurrentToken);
+    name = CurrentToken.value.string;
+    advance();
 
     // Create a new symbol in current scope
     sym = addsymbol(name, S_FUNCTION, P_VOID);
@@ -166,6 +188,7 @@ ASTnode *function_declaration(void)
         fprintf(stderr, "Error: redefinition of '%s' at %d:%d\n", name, Line, Column);
         exit(1);
     }
+    sym->inlining = inlining;
 
     // Enter Scope
     prevFunc = CurrentFunction;
@@ -181,7 +204,7 @@ ASTnode *function_declaration(void)
     match(T_LPAREN);
     while (CurrentToken.type != T_RPAREN)
     {
-        char name[MAX_LEN];
+        char *name;
         PType ptype;
 
         // Get identifier
@@ -190,8 +213,8 @@ ASTnode *function_declaration(void)
             fprintf(stderr, "Syntax Error: expected param name at %d:%d\n", Line, Column);
             exit(1);
         }
-        strncpy(name, CurrentToken.value.string, MAX_LEN);
-        scan(&CurrentToken);
+        name = CurrentToken.value.string;
+        advance();
 
         // Get type
         match(T_COLON);
@@ -216,7 +239,7 @@ ASTnode *function_declaration(void)
 
         if (CurrentToken.type == T_COMMA)
         {
-            scan(&CurrentToken);
+            advance();
         }
         else
         {
@@ -240,23 +263,13 @@ ASTnode *function_declaration(void)
 
     // Body
     match(T_LBRACE);
+    mark = seq_begin();
     while (CurrentToken.type != T_RBRACE)
     {
-        ASTnode *stmt = single_statement();
-
-        if (stmt != NULL)
-        {
-            if (body == NULL)
-            {
-                body = stmt;
-            }
-            else
-            {
-                body = mkastbinary(A_GLUE, body, stmt, NO_VALUE);
-            }
-        }
+        seq_add(single_statement());
     }
-    scan(&CurrentToken);
+    body = seq_end(mark);
+    advance();
 
     // Calculate stack frame
     int frameSize = -LocalOffset;
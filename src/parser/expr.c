@@ -169,17 +169,17 @@ static ASTnode *primary(void)
     {
     case T_INTLIT:
         expr = mkastleaf(A_INTLIT, P_INT, CurrentToken.value);
-        scan(&CurrentToken);
+        advance();
 
         return expr;
     case T_TRUE:
         expr = mkastleaf(A_TRUE, P_BOOL, (Value){1});
-        scan(&CurrentToken);
+        advance();
 
         return expr;
     case T_FALSE:
         expr = mkastleaf(A_FALSE, P_BOOL, (Value){0});
-        scan(&CurrentToken);
+        advance();
 
         return expr;
     case T_IDENT:
@@ -195,12 +195,23 @@ static ASTnode *primary(void)
         switch (sym->stype)
         {
         case S_CONSTANT:
+            // Known constants are literals, except as an assignment target so binary() can reject it
+            if (sym->sclass == C_IMMEDIATE && !(peek(1) >= T_ASSIGN && peek(1) <= T_ASDPIPE))
+            {
+                advance();
+                if (sym->ptype == P_BOOL)
+                {
+                    return mkastleaf(sym->value ? A_TRUE : A_FALSE, P_BOOL, (Value){sym->value});
+                }
+                return mkastleaf(A_INTLIT, P_INT, (Value){.integer = sym->value});
+            }
+            // fall through
         case S_VARIABLE:
-            scan(&CurrentToken);
+            advance();
             return mkastleaf(A_IDENT, sym->ptype, (Value){.symbol = sym});
         case S_FUNCTION:
         {
-            scan(&CurrentToken);
+            advance();
             match(T_LPAREN);
 
             // Parse arguments
@@ -217,14 +228,14 @@ static ASTnode *primary(void)
                 }
                 else
                 {
-                    argsTail->right = mkastbinary(A_GLUE, arg, NULL, NO_VALUE);
-                    argsTail = argsTail->right;
+                    argsTail->right = AST_ID(mkastbinary(A_GLUE, arg, NULL, NO_VALUE));
+                    argsTail = AST_RIGHT(argsTail);
                 }
                 argCount++;
 
                 if (CurrentToken.type == T_COMMA)
                 {
-                    scan(&CurrentToken);
+                    advance();
                 }
                 else
                 {
@@ -244,7 +255,7 @@ static ASTnode *primary(void)
         }
         }
     case T_LPAREN:
-        scan(&CurrentToken);
+        advance();
         expr = expression();
         match(T_RPAREN);
 
@@ -253,7 +264,7 @@ static ASTnode *primary(void)
     case T_MINUS:
     case T_BANG:
         tokentype = CurrentToken.type;
-        scan(&CurrentToken);
+        advance();
         expr = primary();
 
         return mkastunary(unary_ast_op(tokentype), expr, NO_VALUE);
@@ -281,7 +292,7 @@ static ASTnode *binary(int ptp)
     tokentype = CurrentToken.type;
     while (op_precedence(tokentype) > ptp)
     {
-        scan(&CurrentToken);
+        advance();
 
         // Right-associativity
         if (tokentype >= T_ASSIGN && tokentype <= T_ASDPIPE)
@@ -301,9 +312,9 @@ static ASTnode *binary(int ptp)
                 fprintf(stderr, "Syntax Error: assignment to non-identifier at %d:%d\n", Line, Column);
                 exit(1);
             }
-            if (left->value.symbol->stype == S_CONSTANT)
+            if (AST_VALUE(left).symbol->stype == S_CONSTANT)
             {
-                fprintf(stderr, "Type Error: cannot reassign constant '%s' at %d:%d\n", left->value.symbol->name, Line, Column);
+                fprintf(stderr, "Type Error: cannot reassign constant '%s' at %d:%d\n", AST_VALUE(left).symbol->name, Line, Column);
                 exit(1);
             }
         }
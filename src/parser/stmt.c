@@ -52,13 +52,50 @@ static ASTnode *if_statement(void)
     // Parse optional else block
     if (CurrentToken.type == T_ELSE)
     {
-        scan(&CurrentToken);
+        advance();
         false_body = single_statement();
     }
 
     return mkastternary(A_IFELSE, cond, true_body, false_body, NO_VALUE);
 }
 
+/**
+ * Builds a match that evaluates its scrutinee once. When every case is a literal the code
+ * generators dispatch on a single value, otherwise the node carries a hidden 8 byte variable
+ * where the direct code generator keeps the full value of the scrutinee between the tests.
+ *
+ * @param cond The scrutinee
+ * @param cases The cases, the default last
+ * @return The AST node
+ */
+static ASTnode *hoist_scrutinee(ASTnode *cond, ASTnode *cases)
+{
+    static int count = 0;
+    ASTnode *n = mkastbinary(A_MATCH, cond, cases, NO_VALUE);
+    char buf[32];
+    int len, prevOffset;
+    Symbol *sym;
+
+    if (is_const(cond) || literal_cases(n))
+    {
+        return n;
+    }
+    // The dot keeps the name out of the reach of the program
+    len = snprintf(buf, sizeof(buf), "match.%d", count++);
+    prevOffset = LocalOffset;
+    sym = addsymbol(name_of(intern(buf, len, strhash(buf, len))), S_VARIABLE, cond->ptype);
+
+    // A full register, an int slot would cut the value down before the cases compare it
+    sym->size = 8;
+    if (sym->sclass == C_LOCAL)
+    {
+        LocalOffset = (prevOffset - sym->size) & ~(sym->size - 1);
+        sym->offset = LocalOffset;
+    }
+    AST_VALUE(n).symbol = sym;
+    return n;
+}
+
 /**
  * Parse a match statement.
  *
@@ -85,7 +122,7 @@ static ASTnode *match_statement(void)
         // Default case
         if (CurrentToken.type == T_UNDERSCORE)
         {
-            scan(&CurrentToken);
+            advance();
         }
         // Case
         else
@@ -117,12 +154,14 @@ static ASTnode *match_statement(void)
             }
             else
             {
-                cases_tail->right = mkastternary(A_CASE, val, body, NULL, NO_VALUE);
-                cases_tail = cases_tail->right;
+                ASTnode *c = mkastternary(A_CASE, val, body, NULL, NO_VALUE);
+
+                cases_tail->right = AST_ID(c);
+                cases_tail = c;
             }
         }
     }
-    scan(&CurrentToken);
+    advance();
 
     // Add default case
     if (def != NULL)
@@ -133,11 +172,11 @@ static ASTnode *match_statement(void)
         }
         else
         {
-            cases_tail->right = def;
+            cases_tail->right = AST_ID(def);
         }
     }
 
-    return mkastbinary(A_MATCH, cond, cases, NO_VALUE);
+    return hoist_scrutinee(cond, cases);
 }
 
 /**
@@ -171,7 +210,7 @@ static ASTnode *loop_statement(void)
     // For loop without init
     if (CurrentToken.type == T_SEMICOLON)
     {
-        scan(&CurrentToken);
+        advance();
     }
     // For loop with var declaration
     else if (CurrentToken.type == T_VAR)
@@ -181,7 +220,7 @@ static ASTnode *loop_statement(void)
     }
     else if (CurrentToken.type == T_IDENT)
     {
-        int next = peek();
+        int next = peek(1);
 
         // For loop with initialization
         if (next >= T_ASSIGN && next <= T_ASDPIPE)
@@ -261,7 +300,7 @@ static ASTnode *loop_statement(void)
  */
 static ASTnode *block_statement(void)
 {
-    ASTnode *seq = NULL;
+    int mark;
 
     match(T_LBRACE);
 
@@ -269,28 +308,17 @@ static ASTnode *block_statement(void)
     scope_enter();
 
     // Parse statements
+    mark = seq_begin();
     while (CurrentToken.type != T_RBRACE)
     {
-        ASTnode *stmt = single_statement();
-
-        if (stmt != NULL)
-        {
-            if (seq == NULL)
-            {
-                seq = stmt;
-            }
-            else
-            {
-                seq = mkastbinary(A_GLUE, seq, stmt, NO_VALUE);
-            }
-        }
+        seq_add(single_statement());
     }
-    scan(&CurrentToken);
+    advance();
 
     // Exit of scope
     scope_exit();
 
-    return seq;
+    return seq_end(mark);
 }
 
 // TODO: replace with std library
@@ -323,6 +351,8 @@ ASTnode *single_statement(void)
     case T_VAR:
         return semicolon(var_declaration);
     case T_FUN:
+    case T_INLINE:
+    case T_NOINLINE:
         return function_declaration();
     // Control Flow
     case T_IF:
@@ -333,7 +363,7 @@ ASTnode *single_statement(void)
         return loop_statement();
     case T_RETURN:
     {
-        scan(&CurrentToken);
+        advance();
 
         ASTnode *expr = CurrentToken.type != T_SEMICOLON ? expression() : NULL;
 
@@ -341,11 +371,11 @@ ASTnode *single_statement(void)
         return mkastunary(A_RETURN, expr, (Value){.symbol = CurrentFunction});
     }
     case T_STOP:
-        scan(&CurrentToken);
+        advance();
         match(T_SEMICOLON);
         return mkastleaf(A_STOP, P_VOID, NO_VALUE);
     case T_NEXT:
-        scan(&CurrentToken);
+        advance();
         match(T_SEMICOLON);
         return mkastleaf(A_NEXT, P_VOID, NO_VALUE);
     // Block
@@ -366,29 +396,20 @@ ASTnode *single_statement(void)
  */
 ASTnode *compound_statement(void)
 {
-    ASTnode *seq = NULL;
+    ASTnode *seq;
+    int mark;
 
     // Enter a new scope
     scope_enter();
 
     // Parse statements
+    mark = seq_begin();
     while (CurrentToken.type != T_EOF)
     {
-        ASTnode *stmt = single_statement();
-
-        if (stmt != NULL)
-        {
-            if (seq == NULL)
-            {
-                seq = stmt;
-            }
-            else
-            {
-                seq = mkastbinary(A_GLUE, seq, stmt, NO_VALUE);
-            }
-        }
+        seq_add(single_statement());
     }
-    scan(&CurrentToken);
+    seq = seq_end(mark);
+    advance();
 
     // Exit of scope
     if (!is_global_scope())
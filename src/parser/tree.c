@@ -10,14 +10,25 @@
  ********************************************************************************/
 
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "defs.h"
 #include "data.h"
 #include "decl.h"
 
+static int NumChunks = 0;   // Chunks in use
+static int MaxChunks = 0;   // Capacity of ASTchunks
+static NodeId NextNode = 0; // Index of the next free node
+
+static NodeId *SeqStack = NULL; // Statements of the sequences being parsed
+static int SeqTop = 0;          // Used entries of SeqStack
+static int SeqMax = 0;          // Capacity of SeqStack
+
 /**
- * Allocates a new AST node.
+ * Allocates a new AST node, nodes are numbered in order and live in fixed size chunks so
+ * their addresses never move.
  *
  * @param type AST node type
  * @param ptype Primary type
@@ -28,23 +39,429 @@
  */
 static ASTnode *mkastnode(ASTnodeType type, PType ptype, ASTnode *left, ASTnode *mid, ASTnode *right, Value value)
 {
-    ASTnode *n = (ASTnode *)malloc(sizeof(ASTnode));
+    ASTnode *n;
 
-    if (n == NULL)
+    // Node 0 is never handed out, it stands for NULL
+    if (NextNode == 0 || (NextNode & (AST_CHUNK - 1)) == 0)
     {
-        fprintf(stderr, "Fatal Error: out of memory\n");
-        exit(1);
+        if (NumChunks == MAX_AST_CHUNKS)
+        {
+            fprintf(stderr, "Fatal Error: program too large, more than %d AST nodes\n", MAX_AST_CHUNKS * AST_CHUNK);
+            exit(1);
+        }
+        if (NumChunks == MaxChunks)
+        {
+            MaxChunks = MaxChunks ? MaxChunks * 2 : 16;
+            if ((ASTchunks = (ASTchunk **)realloc(ASTchunks, MaxChunks * sizeof(ASTchunk *))) == NULL)
+            {
+                fprintf(stderr, "Fatal Error: out of memory\n");
+                exit(1);
+            }
+        }
+        ASTchunks[NumChunks++] = (ASTchunk *)arena_alloc(&AstArena, sizeof(ASTchunk));
+        if (NextNode == 0)
+        {
+            NextNode = 1;
+        }
     }
 
+    n = &ASTchunks[NextNode >> AST_CHUNK_BITS]->node[NextNode & (AST_CHUNK - 1)];
     n->type = type;
     n->ptype = ptype;
-    n->left = left;
-    n->mid = mid;
-    n->right = right;
-    n->value = value;
+    n->chunk = NextNode >> AST_CHUNK_BITS;
+    n->left = AST_ID(left);
+    n->mid = AST_ID(mid);
+    n->right = AST_ID(right);
+    AST_VALUE(n) = value;
+    NextNode++;
     return n;
 }
 
+/**
+ * Starts collecting the statements of a sequence, sequences can nest.
+ *
+ * @return Mark to hand to seq_end()
+ */
+int seq_begin(void)
+{
+    return SeqTop;
+}
+
+/**
+ * Adds a statement to the innermost open sequence.
+ *
+ * @param stmt The statement, NULL is ignored
+ */
+void seq_add(ASTnode *stmt)
+{
+    if (stmt == NULL)
+    {
+        return;
+    }
+
+    if (SeqTop == SeqMax)
+    {
+        SeqMax = SeqMax ? SeqMax * 2 : 256;
+        if ((SeqStack = (NodeId *)realloc(SeqStack, SeqMax * sizeof(NodeId))) == NULL)
+        {
+            fprintf(stderr, "Fatal Error: out of memory\n");
+            exit(1);
+        }
+    }
+    SeqStack[SeqTop++] = AST_ID(stmt);
+}
+
+/**
+ * Closes a sequence, its statements are copied into an A_SEQ node.
+ *
+ * @param mark Value returned by seq_begin()
+ * @return The A_SEQ node, the statement itself if there is only one, or NULL if there is none
+ */
+ASTnode *seq_end(int mark)
+{
+    int count = SeqTop - mark;
+    NodeList *list;
+
+    if (count <= 1)
+    {
+        SeqTop = mark;
+        return count ? AST_NODE(SeqStack[mark]) : NULL;
+    }
+
+    list = (NodeList *)arena_alloc(&AstArena, sizeof(NodeList) + count * sizeof(NodeId));
+    list->count = count;
+    memcpy(list->item, SeqStack + mark, count * sizeof(NodeId));
+    SeqTop = mark;
+    return mkastleaf(A_SEQ, P_VOID, (Value){.list = list});
+}
+
+/**
+ * Releases every AST node.
+ */
+void free_ast(void)
+{
+    arena_free(&AstArena);
+    free(ASTchunks);
+    ASTchunks = NULL;
+    NumChunks = MaxChunks = 0;
+    NextNode = 0;
+
+    free(SeqStack);
+    SeqStack = NULL;
+    SeqTop = SeqMax = 0;
+}
+
+/**
+ * Checks if a node is a constant.
+ *
+ * @param n The node
+ * @return 1 if it is an integer or boolean literal, 0 otherwise
+ */
+int is_const(ASTnode *n)
+{
+    return n->type == A_INTLIT || n->type == A_TRUE || n->type == A_FALSE;
+}
+
+/**
+ * Value of a constant node, booleans are 0 or 1.
+ *
+ * @param n A constant node
+ * @return Its value
+ */
+long long const_value(ASTnode *n)
+{
+    return n->type == A_INTLIT ? AST_VALUE(n).integer : n->type == A_TRUE;
+}
+
+/**
+ * Checks if every case of a match compares against a constant, so it can dispatch on a single
+ * value of the scrutinee.
+ *
+ * @param n The match node
+ * @return 1 if the cases are constants, the default aside
+ */
+int literal_cases(ASTnode *n)
+{
+    for (ASTnode *c = AST_RIGHT(n); c != NULL; c = AST_RIGHT(c))
+    {
+        if (AST_LEFT(c) != NULL && !is_const(AST_LEFT(c)))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Checks if evaluating a tree has no side effects, so it can be dropped.
+ *
+ * @param n Root of the tree
+ * @return 1 if it is pure, 0 otherwise
+ */
+static int is_pure(ASTnode *n)
+{
+    if (n == NULL)
+    {
+        return 1;
+    }
+    if (n->type == A_CALL || (n->type >= A_ASSIGN && n->type <= A_ASOR))
+    {
+        return 0;
+    }
+    return is_pure(AST_LEFT(n)) && is_pure(AST_MID(n)) && is_pure(AST_RIGHT(n));
+}
+
+/**
+ * Checks if two pure trees always compute the same value.
+ *
+ * @param a First tree
+ * @param b Second tree
+ * @return 1 if they are the same expression, 0 otherwise
+ */
+static int same_expr(ASTnode *a, ASTnode *b)
+{
+    if (a == NULL || b == NULL)
+    {
+        return a == b;
+    }
+    if (a->type != b->type)
+    {
+        return 0;
+    }
+    switch (a->type)
+    {
+    case A_INTLIT:
+        return AST_VALUE(a).integer == AST_VALUE(b).integer;
+    case A_IDENT:
+        return AST_VALUE(a).symbol == AST_VALUE(b).symbol;
+    case A_CALL:
+        return 0;
+    default:
+        return same_expr(AST_LEFT(a), AST_LEFT(b)) && same_expr(AST_MID(a), AST_MID(b)) &&
+               same_expr(AST_RIGHT(a), AST_RIGHT(b));
+    }
+}
+
+/**
+ * Builds a literal node, integers that do not fit in 32 bits are not literals.
+ *
+ * @param ptype P_INT or P_BOOL
+ * @param v The value
+ * @return The literal node, or NULL if the value does not fit
+ */
+static ASTnode *mkconst(PType ptype, long long v)
+{
+    if (ptype == P_BOOL)
+    {
+        return mkastleaf(v ? A_TRUE : A_FALSE, P_BOOL, (Value){v != 0});
+    }
+    if (v < INT32_MIN || v > INT32_MAX)
+    {
+        return NULL;
+    }
+    return mkastleaf(A_INTLIT, P_INT, (Value){.integer = (int)v});
+}
+
+/**
+ * Folds a unary operation.
+ *
+ * @param type A_POS, A_NEG or A_NOT
+ * @param child The operand
+ * @return The simplified tree, or NULL if nothing can be folded
+ */
+static ASTnode *fold_unary(ASTnodeType type, ASTnode *child)
+{
+    if (type == A_POS)
+    {
+        return child; // +x
+    }
+    if (child->type == type)
+    {
+        return AST_LEFT(child); // -(-x), !!b
+    }
+    if (!is_const(child))
+    {
+        return NULL;
+    }
+    return type == A_NEG ? mkconst(P_INT, -const_value(child)) : mkconst(P_BOOL, !const_value(child));
+}
+
+/**
+ * Computes a binary operation on two constants the way the generated code does.
+ *
+ * @param type The operation
+ * @param a Left value
+ * @param b Right value
+ * @param ok Set to 0 when the result must be left to run time
+ * @return The result
+ */
+long long eval_binary(ASTnodeType type, long long a, long long b, int *ok)
+{
+    long long r = 1;
+
+    *ok = 1;
+    switch (type)
+    {
+    case A_ADD:
+        return a + b;
+    case A_SUB:
+        return a - b;
+    case A_MUL:
+        return a * b;
+    case A_DIV:
+    case A_MOD:
+        // Division by zero is left to the target
+        if (b == 0)
+        {
+            *ok = 0;
+            return 0;
+        }
+        return type == A_DIV ? a / b : a % b;
+    case A_POW:
+        // A negative exponent gives 1 / a ** -b rounded toward zero, 0 for a base of 0
+        if (b < 0)
+        {
+            return a == 1 ? 1 : a == -1 ? (b % 2 ? -1 : 1) : 0;
+        }
+        if (b == 0 || a == 0 || a == 1)
+        {
+            return b == 0 ? 1 : a;
+        }
+        if (a == -1)
+        {
+            return b % 2 ? -1 : 1;
+        }
+        // Any other base leaves 32 bits within 32 steps
+        for (long long i = 0; i < b; i++)
+        {
+            r *= a;
+            if (r < INT32_MIN || r > INT32_MAX)
+            {
+                *ok = 0;
+                return 0;
+            }
+        }
+        return r;
+    case A_EQ:
+        return a == b;
+    case A_NEQ:
+        return a != b;
+    case A_LT:
+        return a < b;
+    case A_LE:
+        return a <= b;
+    case A_GT:
+        return a > b;
+    case A_GE:
+        return a >= b;
+    case A_AND:
+        return a && b;
+    case A_OR:
+        return a || b;
+    default:
+        *ok = 0;
+        return 0;
+    }
+}
+
+/**
+ * Folds a binary operation, applies identities such as x + 0 and annihilators such as x * 0.
+ * An operand that would have run is only dropped when evaluating it has no side effects.
+ *
+ * @param type The operation
+ * @param ptype Type of the result
+ * @param left Left operand
+ * @param right Right operand
+ * @return The simplified tree, or NULL if nothing can be folded
+ */
+static ASTnode *fold_binary(ASTnodeType type, PType ptype, ASTnode *left, ASTnode *right)
+{
+    int lc = is_const(left), rc = is_const(right);
+    long long l = lc ? const_value(left) : 0, r = rc ? const_value(right) : 0;
+
+    if (lc && rc)
+    {
+        int ok;
+        long long v = eval_binary(type, l, r, &ok);
+
+        return ok ? mkconst(ptype, v) : NULL;
+    }
+
+    switch (type)
+    {
+    case A_ADD:
+        if (rc && r == 0)
+        {
+            return left; // x + 0
+        }
+        if (lc && l == 0)
+        {
+            return right; // 0 + x
+        }
+        break;
+    case A_SUB:
+        if (rc && r == 0)
+        {
+            return left; // x - 0
+        }
+        if (same_expr(left, right) && is_pure(left))
+        {
+            return mkconst(P_INT, 0); // x - x
+        }
+        break;
+    case A_MUL:
+        if ((rc && r == 1) || (lc && l == 1))
+        {
+            return rc ? left : right; // x * 1
+        }
+        if ((rc && r == 0 && is_pure(left)) || (lc && l == 0 && is_pure(right)))
+        {
+            return mkconst(P_INT, 0); // x * 0
+        }
+        break;
+    case A_DIV:
+    case A_POW:
+        if (rc && r == 1)
+        {
+            return left; // x / 1, x ** 1
+        }
+        if (type == A_POW && rc && r == 0 && is_pure(left))
+        {
+            return mkconst(P_INT, 1); // x ** 0
+        }
+        break;
+    case A_MOD:
+        if (rc && r == 1 && is_pure(left))
+        {
+            return mkconst(P_INT, 0); // x % 1
+        }
+        break;
+    case A_AND:
+    case A_OR:
+        // A constant on the left decides alone, the right side never runs
+        if (lc)
+        {
+            return l == (type == A_AND) ? right : mkconst(P_BOOL, l); // true && b, false && b
+        }
+        // A constant on the right needs the left side to run, unless it is pure
+        if (rc)
+        {
+            if (r == (type == A_AND))
+            {
+                return left; // b && true, b || false
+            }
+            if (is_pure(left))
+            {
+                return mkconst(P_BOOL, r); // b && false, b || true
+            }
+        }
+        break;
+    default:
+        break;
+    }
+    return NULL;
+}
+
 /**
  * Creates a leaf node (Literal or Identifier).
  *
@@ -66,6 +483,8 @@ ASTnode *mkastleaf(ASTnodeType type, PType ptype, Value value)
  */
 ASTnode *mkastunary(ASTnodeType type, ASTnode *child, Value value)
 {
+    ASTnode *folded;
+
     switch (type)
     {
     // Unary
@@ -76,6 +495,10 @@ ASTnode *mkastunary(ASTnodeType type, ASTnode *child, Value value)
             fprintf(stderr, "Type Error: unary +/- requires integer operand at %d:%d\n", Line, Column);
             exit(1);
         }
+        if ((folded = fold_unary(type, child)) != NULL)
+        {
+            return folded;
+        }
         return mkastnode(type, P_INT, child, NULL, NULL, value);
     case A_NOT:
         if (child->ptype != P_BOOL)
@@ -83,6 +506,10 @@ ASTnode *mkastunary(ASTnodeType type, ASTnode *child, Value value)
             fprintf(stderr, "Type Error: unary ! requires boolean operand at %d:%d\n", Line, Column);
             exit(1);
         }
+        if ((folded = fold_unary(type, child)) != NULL)
+        {
+            return folded;
+        }
         return mkastnode(type, P_BOOL, child, NULL, NULL, value);
     // Functions
     case A_FUNCTION:
@@ -124,6 +551,8 @@ ASTnode *mkastunary(ASTnodeType type, ASTnode *child, Value value)
  */
 ASTnode *mkastbinary(ASTnodeType type, ASTnode *left, ASTnode *right, Value value)
 {
+    ASTnode *folded;
+
     switch (type)
     {
     // Arithmetic
@@ -138,6 +567,10 @@ ASTnode *mkastbinary(ASTnodeType type, ASTnode *left, ASTnode *right, Value valu
             fprintf(stderr, "Type Error: arithmetic op requires integer operands at %d:%d\n", Line, Column);
             exit(1);
         }
+        if ((folded = fold_binary(type, P_INT, left, right)) != NULL)
+        {
+            return folded;
+        }
         return mkastnode(type, P_INT, left, NULL, right, value);
     // Comparison
     case A_EQ:
@@ -147,6 +580,10 @@ ASTnode *mkastbinary(ASTnodeType type, ASTnode *left, ASTnode *right, Value valu
             fprintf(stderr, "Type Error: comparison requires operands of same type at %d:%d\n", Line, Column);
             exit(1);
         }
+        if ((folded = fold_binary(type, P_BOOL, left, right)) != NULL)
+        {
+            return folded;
+        }
         return mkastnode(type, P_BOOL, left, NULL, right, value);
     case A_LT:
     case A_LE:
@@ -157,6 +594,10 @@ ASTnode *mkastbinary(ASTnodeType type, ASTnode *left, ASTnode *right, Value valu
             fprintf(stderr, "Type Error: order comparison requires integer operands at %d:%d\n", Line, Column);
             exit(1);
         }
+        if ((folded = fold_binary(type, P_BOOL, left, right)) != NULL)
+        {
+            return folded;
+        }
         return mkastnode(type, P_BOOL, left, NULL, right, value);
     // Logical
     case A_AND:
@@ -166,6 +607,10 @@ ASTnode *mkastbinary(ASTnodeType type, ASTnode *left, ASTnode *right, Value valu
             fprintf(stderr, "Type Error: logical op requires boolean operands at %d:%d\n", Line, Column);
             exit(1);
         }
+        if ((folded = fold_binary(type, P_BOOL, left, right)) != NULL)
+        {
+            return folded;
+        }
         return mkastnode(type, P_BOOL, left, NULL, right, value);
     // Assignment
     case A_ASSIGN: